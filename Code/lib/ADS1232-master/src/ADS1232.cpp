@@ -8,14 +8,19 @@
 #include "Arduino.h"
 #include "ADS1232.h"
 
-ADS1232::ADS1232(byte pdwn, byte sclk, byte dout) {
+ADS1232::ADS1232(byte pdwn, byte sclk, byte dout, byte speed) {
   PDWN = pdwn;
   SCLK = sclk;
   DOUT = dout;
+  SPEED = speed;
 
   pinMode(PDWN, OUTPUT);
   pinMode(SCLK, OUTPUT);
   pinMode(DOUT, INPUT_PULLUP);
+  if (SPEED != NO_PIN) {
+    pinMode(SPEED, OUTPUT);
+    digitalWrite(SPEED, SPEED_10SPS);
+  }
 }
 
 ADS1232::~ADS1232() {
@@ -37,6 +42,14 @@ void ADS1232::power_down() {
   digitalWrite(SCLK,HIGH);
 }
 
+// From datasheet: a new data rate resets the digital filter, so the conversions
+// that follow need the filter's settling time before they are valid
+void ADS1232::set_speed(Speed speed) {
+  if (SPEED != NO_PIN) {
+    digitalWrite(SPEED, speed);
+  }
+}
+
 void ADS1232::set_offset(long offset) {
   OFFSET = offset;
 }
@@ -54,6 +67,23 @@ long ADS1232::_raw_read() {
   while (is_ready()) {};
    while (!is_ready()) {};
 
+  return _shift_in();
+}
+
+// Non-blocking variant of _raw_read(): returns false straight away when no conversion is
+// pending. The 25th SCLK pulse forces DOUT high so the same conversion is never read twice.
+bool ADS1232::read_if_ready(long & value) {
+  if (!is_ready()) {
+    return false;
+  }
+
+  value = _shift_in();
+  digitalWrite(SCLK, HIGH);
+  digitalWrite(SCLK, LOW);
+  return true;
+}
+
+long ADS1232::_shift_in() {
   long value = 0;
   long to_add = 0;
   byte data[3] = { 0 };
@@ -16,21 +16,32 @@ class ADS1232
     byte PDWN;         // power down pin
     byte SCLK;         // serial clock pin
     byte DOUT;         // serial data out pin
+    byte SPEED;        // data rate pin, NO_PIN if tied off
     long OFFSET = 0;   // used for tare
     float SCALE = 1.0; // used to scale weight to grams/kg/ounces
 
-    ADS1232(byte pdwn, byte sclk, byte dout);
+    static const byte NO_PIN = 0xFF;
+
+    // Levels of the SPEED pin
+    enum Speed { SPEED_10SPS = LOW, SPEED_80SPS = HIGH };
+
+    ADS1232(byte pdwn, byte sclk, byte dout, byte speed = NO_PIN);
     ~ADS1232();
     bool is_ready();
     bool safeWait();
     void power_up();
     void power_down();
+    void set_speed(Speed speed);
     void calibrateADC(); //this is the internal calibration method of the ADC , not the calculation of the calFactor
     void set_offset(long offset = 0);
     void set_scale(float scale = 1.0f);
     long _raw_read();
+    bool read_if_ready(long & value);
     long raw_read(byte times = 1);
     float units_read(byte times = 1);
+
+  private:
+    long _shift_in();
 };
 
 #endif
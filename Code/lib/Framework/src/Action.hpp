@@ -3,80 +3,290 @@
 #include <functional>
 #include <vector>
 
+/**
+ * Returned when scheduling an action. Use it to cancel the action in O(1). A handle goes stale
+ * once its action completes or is cancelled; cancelling a stale handle does nothing.
+ */
+struct ActionHandle {
+	unsigned short slot		  = 0xFFFF;
+	unsigned short generation = 0;
+
+	ActionHandle() = default;
+	ActionHandle(unsigned short slot, unsigned short generation)
+		: slot(slot),
+		  generation(generation) {}
+
+	bool isValid() const {
+		return slot != 0xFFFF;
+	}
+};
+
+/**
+ * How a repeating action picks its next deadline.
+ *
+ * fixedDelay: interval counted from the end of the callback (drifts by loop latency + runtime)
+ * catchUp:    deadline += interval; missed periods run back to back until caught up
+ * skip:       deadline += interval; missed periods are dropped and counted
+ */
+enum class ActionTiming : unsigned char { fixedDelay, catchUp, skip };
+
+/**
+ * Per-action timing statistics. Lateness is how long after its deadline the callback started.
+ */
+struct ActionStats {
+	unsigned long runs			 = 0;
+	unsigned long totalLateness	 = 0;
+	unsigned long maxLateness	 = 0;
+	unsigned long maxRuntime	 = 0;
+	unsigned long overruns		 = 0;
+	unsigned long skippedPeriods = 0;
+
+	unsigned long meanLateness() const {
+		return runs ? totalLateness / runs : 0;
+	}
+};
+
 class TimedAction {
 protected:
 	friend class ActionScheduler;
-	bool removable = false;
-	long start	   = 0;
+	uint64_t deadline = 0;
+	ActionStats stats;
 
 	void begin() {
-		removable = false;
-		start	  = millis();
+		deadline = uptimeMillis() + interval;
+	}
+
+	// Advance the deadline after a run that started at `started` and finished at `finished`
+	void advance(uint64_t started, uint64_t finished) {
+		unsigned long lateness = started - deadline;
+		unsigned long runtime  = finished - started;
+		stats.runs++;
+		stats.totalLateness += lateness;
+		stats.maxLateness = std::max(stats.maxLateness, lateness);
+		stats.maxRuntime  = std::max(stats.maxRuntime, runtime);
+		if (interval > 0 && runtime > static_cast<unsigned long>(interval)) {
+			stats.overruns++;
+		}
+
+		switch (timing) {
+		case ActionTiming::fixedDelay:
+			deadline = finished + interval;
+			break;
+		case ActionTiming::catchUp:
+			deadline += interval;
+			break;
+		case ActionTiming::skip:
+			deadline += interval;
+			if (interval > 0 && finished >= deadline) {
+				auto missed = (finished - deadline) / interval + 1;
+				deadline += missed * interval;
+				stats.skippedPeriods += missed;
+			}
+			break;
+		}
 	}
 
 public:
 	long interval		  = 0;
 	signed char repeatFor = 0;
-	const char * name;
+	ActionTiming timing	  = ActionTiming::fixedDelay;
+	const char * name	  = nullptr;
 
 	std::function<void()> callback;
 	TimedAction() = default;
 	TimedAction(const char * name) : name(name) {}
 
 	long timeElapsed() const {
-		return millis() - start;
+		return uptimeMillis() - (deadline - interval);
 	}
 
 	bool isReady() const {
-		return timeElapsed() >= interval;
+		return uptimeMillis() >= deadline;
 	}
 };
 
+/**
+ * Min-heap of actions keyed on their absolute deadline. update() only touches the actions that
+ * are due; everything else costs nothing until its deadline comes up.
+ */
 class ActionScheduler : public KPComponent {
-public:
-	std::vector<TimedAction> actions;
+private:
+	struct Slot {
+		TimedAction action;
+		unsigned short generation = 0;
+		bool active				  = false;
+	};
+
+	struct Entry {
+		uint64_t deadline;
+		unsigned short slot;
+	};
+
+	static bool later(const Entry & a, const Entry & b) {
+		return a.deadline > b.deadline;
+	}
+
+	std::vector<Slot> slots;
+	std::vector<unsigned short> freeSlots;
+	std::vector<Entry> heap;
+
+	void push(unsigned short slot) {
+		heap.push_back({slots[slot].action.deadline, slot});
+		std::push_heap(heap.begin(), heap.end(), later);
+	}
+
+	unsigned short pop() {
+		std::pop_heap(heap.begin(), heap.end(), later);
+		auto slot = heap.back().slot;
+		heap.pop_back();
+		return slot;
+	}
+
+	void release(unsigned short slot) {
+		slots[slot].active			= false;
+		slots[slot].action.callback = nullptr;
+		slots[slot].generation++;
+		freeSlots.push_back(slot);
+	}
+
+	// Cancelled actions stay in the heap until they surface; drop them so the top is live
+	void discardCancelled() {
+		while (!heap.empty() && !slots[heap.front().slot].active) {
+			release(pop());
+		}
+	}
 
+public:
 	ActionScheduler(const char * name) : KPComponent(name) {}
 
 	template <typename T>
-	void add(T && action) {
-		actions.push_back(std::move(action));
-		actions.back().begin();
+	ActionHandle add(T && action) {
+		unsigned short slot;
+		if (freeSlots.empty()) {
+			slot = slots.size();
+			slots.emplace_back();
+		} else {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+
+		auto & s  = slots[slot];
+		s.action  = std::forward<T>(action);
+		s.active  = true;
+		s.action.begin();
+		push(slot);
+		return {slot, s.generation};
+	}
+
+	/**
+	 * Cancel the action referred to by the handle. The slot is reclaimed lazily when its heap
+	 * entry surfaces, so this is O(1) and safe to call from inside the action's own callback.
+	 *
+	 * @param handle Handle returned by add()
+	 */
+	void cancel(const ActionHandle & handle) {
+		if (handle.slot >= slots.size()) {
+			return;
+		}
+
+		auto & s = slots[handle.slot];
+		if (s.active && s.generation == handle.generation) {
+			s.active = false;
+			s.generation++;
+		}
 	}
 
 	void markForRemoval(const char * name) {
-		for (auto & action : actions) {
-			if (strcmp(action.name, name) == 0) {
-				action.removable = true;
+		for (auto & s : slots) {
+			if (s.active && s.action.name && strcmp(s.action.name, name) == 0) {
+				s.active = false;
+				s.generation++;
 			}
 		}
 	}
 
-	void removeCompletedActions() {
-		auto predicate = std::remove_if(actions.begin(), actions.end(),
-										[](const TimedAction & a) { return a.removable; });
+	bool empty() {
+		discardCancelled();
+		return heap.empty();
+	}
 
-		actions.erase(predicate, actions.end());
+	/**
+	 * Absolute uptimeMillis() deadline of the earliest live action. Only meaningful when !empty()
+	 */
+	uint64_t nextDeadline() {
+		discardCancelled();
+		return heap.empty() ? uptimeMillis() : heap.front().deadline;
 	}
 
-	void update() override {
-		removeCompletedActions();
+	/**
+	 * Timing statistics of a live action
+	 *
+	 * @param handle Handle returned by add()
+	 * @return const ActionStats* nullptr if the handle is stale
+	 */
+	const ActionStats * stats(const ActionHandle & handle) const {
+		if (handle.slot >= slots.size()) {
+			return nullptr;
+		}
 
-		for (auto & action : actions) {
-			if (action.isReady()) {
-				action.callback();
-			} else {
+		auto & s = slots[handle.slot];
+		return s.active && s.generation == handle.generation ? &s.action.stats : nullptr;
+	}
+
+	void printStats() const {
+		for (auto & s : slots) {
+			if (!s.active || s.action.repeatFor == 0) {
 				continue;
 			}
 
-			if (action.repeatFor == 0) {
-				action.removable = true;
+			auto & st = s.action.stats;
+			println(s.action.name ? s.action.name : "<unnamed>", ": every ", s.action.interval,
+				" ms, runs ", st.runs, ", lateness mean/max ", st.meanLateness(), "/",
+				st.maxLateness, " ms, runtime max ", st.maxRuntime, " ms, overruns ", st.overruns,
+				", skipped ", st.skippedPeriods);
+		}
+	}
+
+	unsigned long idleTime() override {
+		if (empty()) {
+			return IDLE_FOREVER;
+		}
+
+		auto deadline = nextDeadline();
+		auto now	  = uptimeMillis();
+		return deadline > now ? std::min<uint64_t>(deadline - now, IDLE_FOREVER) : 0;
+	}
+
+	void update() override {
+		// Bound the work to what is due now so zero-interval repeats cannot starve the loop
+		for (size_t due = heap.size(); due > 0 && !heap.empty(); due--) {
+			if (uptimeMillis() < heap.front().deadline) {
+				break;
+			}
+
+			auto slot = pop();
+			if (!slots[slot].active) {
+				release(slot);
+				continue;
 			}
 
-			if (!action.removable) {
-				action.begin();
-				action.repeatFor = std::max(action.repeatFor - 1, -1);
+			// The callback may schedule more actions and reallocate slots; run it from a local
+			auto generation = slots[slot].generation;
+			auto callback	= std::move(slots[slot].action.callback);
+			auto started	= uptimeMillis();
+			callback();
+			auto finished = uptimeMillis();
+
+			auto & s = slots[slot];
+			if (!s.active || s.generation != generation || s.action.repeatFor == 0) {
+				release(slot);
+				continue;
 			}
+
+			s.action.callback  = std::move(callback);
+			s.action.repeatFor = std::max(s.action.repeatFor - 1, -1);
+			s.action.advance(started, finished);
+			push(slot);
 		}
 	}
 
@@ -87,31 +297,37 @@ public:
 };
 
 template <typename T>
-inline void run(T && action) {
-	ActionScheduler::sharedInstance().add(std::forward<T>(action));
+inline ActionHandle run(T && action) {
+	return ActionScheduler::sharedInstance().add(std::forward<T>(action));
 }
 
-inline void run(long delay, std::function<void()> callback) {
+inline ActionHandle run(long delay, std::function<void()> callback) {
 	TimedAction action;
 	action.interval = delay;
 	action.callback = callback;
-	ActionScheduler::sharedInstance().add(action);
+	return ActionScheduler::sharedInstance().add(std::move(action));
 }
 
-inline void runForever(long delay, const char * name, std::function<void()> callback) {
+inline ActionHandle runForever(long delay, const char * name, std::function<void()> callback,
+	ActionTiming timing = ActionTiming::fixedDelay) {
 	TimedAction action;
 	action.name		 = name;
 	action.interval	 = delay;
 	action.callback	 = callback;
 	action.repeatFor = -1;
-	ActionScheduler::sharedInstance().add(action);
+	action.timing	 = timing;
+	return ActionScheduler::sharedInstance().add(std::move(action));
 }
 
-inline void runForever(TimedAction action) {
+inline ActionHandle runForever(TimedAction action) {
 	action.repeatFor = -1;
-	ActionScheduler::sharedInstance().add(std::move(action));
+	return ActionScheduler::sharedInstance().add(std::move(action));
 }
 
 inline void cancel(const char * name) {
 	ActionScheduler::sharedInstance().markForRemoval(name);
 }
+
+inline void cancel(const ActionHandle & handle) {
+	ActionScheduler::sharedInstance().cancel(handle);
+}
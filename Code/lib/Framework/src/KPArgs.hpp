@@ -0,0 +1,297 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <KPCommandLine.hpp>
+#include <KPFrame.hpp>
+#include <float.h>
+#include <limits.h>
+
+/**
+ * Typed arguments for commands. Each command declares a constexpr array of KPArgSpec; the tokens
+ * (or binary frame fields) are checked and converted against it before the handler runs, without
+ * allocating and without exceptions. Handlers read the converted values from KPArgs.
+ */
+enum class KPArgType : unsigned char { integer, real, choice, text };
+
+struct KPArgSpec {
+	const char * name;
+	KPArgType type;
+	long min;
+	long max;
+	float realMin;
+	float realMax;
+	const char * const * choices;
+	size_t choiceCount;
+};
+
+constexpr KPArgSpec intArg(const char * name, long min = LONG_MIN, long max = LONG_MAX) {
+	return {name, KPArgType::integer, min, max, 0, 0, nullptr, 0};
+}
+
+constexpr KPArgSpec floatArg(const char * name, float min = -FLT_MAX, float max = FLT_MAX) {
+	return {name, KPArgType::real, 0, 0, min, max, nullptr, 0};
+}
+
+template <size_t N>
+constexpr KPArgSpec choiceArg(const char * name, const char * const (&choices)[N]) {
+	return {name, KPArgType::choice, 0, N - 1, 0, 0, choices, N};
+}
+
+constexpr KPArgSpec textArg(const char * name) {
+	return {name, KPArgType::text, 0, 0, 0, 0, nullptr, 0};
+}
+
+struct KPArgValue {
+	long integer = 0;
+	float real	 = 0;
+	KPStringView text;
+};
+
+enum class KPArgError : unsigned char {
+	none,
+	notInteger,
+	notNumber,
+	outOfRange,
+	notAChoice,
+	truncated
+};
+
+namespace KPArgParser {
+	inline bool isDigit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	/**
+	 * Strict decimal integer: optional sign and digits only, no overflow
+	 */
+	inline bool parseInt(const KPStringView & token, long & out) {
+		size_t i	  = 0;
+		bool negative = token.size > 0 && token.data[0] == '-';
+		if (token.size > 0 && (token.data[0] == '-' || token.data[0] == '+')) {
+			i++;
+		}
+
+		if (i == token.size) {
+			return false;
+		}
+
+		// Accumulate negatively so LONG_MIN parses too
+		long value = 0;
+		for (; i < token.size; i++) {
+			if (!isDigit(token.data[i])) {
+				return false;
+			}
+
+			int digit = token.data[i] - '0';
+			if (value < (LONG_MIN + digit) / 10) {
+				return false;
+			}
+
+			value = value * 10 - digit;
+		}
+
+		if (!negative && value == LONG_MIN) {
+			return false;
+		}
+
+		out = negative ? value : -value;
+		return true;
+	}
+
+	/**
+	 * Decimal number with optional fraction and exponent ("-1.5", "2e3"). Good to float
+	 * precision, which is all the settings need; strtof would pull in newlib's allocating
+	 * big-number code.
+	 */
+	inline bool parseFloat(const KPStringView & token, float & out) {
+		size_t i	  = 0;
+		bool negative = token.size > 0 && token.data[0] == '-';
+		if (token.size > 0 && (token.data[0] == '-' || token.data[0] == '+')) {
+			i++;
+		}
+
+		double value = 0;
+		int digits	 = 0;
+		for (; i < token.size && isDigit(token.data[i]); i++, digits++) {
+			value = value * 10 + (token.data[i] - '0');
+		}
+
+		if (i < token.size && token.data[i] == '.') {
+			double scale = 0.1;
+			for (i++; i < token.size && isDigit(token.data[i]); i++, digits++) {
+				value += (token.data[i] - '0') * scale;
+				scale /= 10;
+			}
+		}
+
+		if (digits == 0) {
+			return false;
+		}
+
+		if (i < token.size && (token.data[i] == 'e' || token.data[i] == 'E')) {
+			long exponent;
+			if (!parseInt({token.data + i + 1, token.size - i - 1}, exponent) || exponent > 38
+				|| exponent < -45) {
+				return false;
+			}
+
+			for (; exponent > 0; exponent--) {
+				value *= 10;
+			}
+
+			for (; exponent < 0; exponent++) {
+				value /= 10;
+			}
+
+			i = token.size;
+		}
+
+		if (i != token.size || value > FLT_MAX) {
+			return false;
+		}
+
+		out = negative ? -value : value;
+		return true;
+	}
+
+	/**
+	 * Check and convert one token against its spec
+	 */
+	inline KPArgError parse(const KPArgSpec & spec, const KPStringView & token, KPArgValue & out) {
+		out.text = token;
+		switch (spec.type) {
+		case KPArgType::integer:
+			if (!parseInt(token, out.integer)) {
+				return KPArgError::notInteger;
+			}
+
+			return out.integer < spec.min || out.integer > spec.max ? KPArgError::outOfRange
+																	: KPArgError::none;
+		case KPArgType::real:
+			if (!parseFloat(token, out.real)) {
+				return KPArgError::notNumber;
+			}
+
+			return out.real < spec.realMin || out.real > spec.realMax ? KPArgError::outOfRange
+																	  : KPArgError::none;
+		case KPArgType::choice:
+			for (size_t i = 0; i < spec.choiceCount; i++) {
+				if (token == spec.choices[i]) {
+					out.integer = i;
+					return KPArgError::none;
+				}
+			}
+
+			return KPArgError::notAChoice;
+		case KPArgType::text:
+			return KPArgError::none;
+		}
+
+		return KPArgError::none;
+	}
+
+	/**
+	 * Read and check one binary field against its spec. Fields are little endian: int32 for
+	 * integers, float32 for reals, a uint8 index for choices and zero terminated text.
+	 */
+	inline KPArgError decode(const KPArgSpec & spec, KPFrame::Reader & in, KPArgValue & out) {
+		switch (spec.type) {
+		case KPArgType::integer: {
+			int32_t value;
+			if (!in.i32(value)) {
+				return KPArgError::truncated;
+			}
+
+			out.integer = value;
+			return out.integer < spec.min || out.integer > spec.max ? KPArgError::outOfRange
+																	: KPArgError::none;
+		}
+		case KPArgType::real:
+			if (!in.f32(out.real)) {
+				return KPArgError::truncated;
+			}
+
+			if (out.real != out.real) {
+				return KPArgError::notNumber;
+			}
+
+			return out.real < spec.realMin || out.real > spec.realMax ? KPArgError::outOfRange
+																	  : KPArgError::none;
+		case KPArgType::choice: {
+			uint8_t index;
+			if (!in.u8(index)) {
+				return KPArgError::truncated;
+			}
+
+			if (index >= spec.choiceCount) {
+				return KPArgError::notAChoice;
+			}
+
+			out.integer = index;
+			out.text	= KPStringView(spec.choices[index], strlen(spec.choices[index]));
+			return KPArgError::none;
+		}
+		case KPArgType::text:
+			return in.text(out.text.data, out.text.size) ? KPArgError::none : KPArgError::truncated;
+		}
+
+		return KPArgError::none;
+	}
+
+	/**
+	 * Print what the spec accepts, e.g. "<samples: 1..1000>" or "<light: idle|run|battery>"
+	 */
+	inline void printSpec(Print & printer, const KPArgSpec & spec) {
+		printTo(printer, "<", spec.name);
+		switch (spec.type) {
+		case KPArgType::integer:
+			if (spec.min != LONG_MIN || spec.max != LONG_MAX) {
+				printTo(printer, ": ", spec.min, "..", spec.max);
+			}
+			break;
+		case KPArgType::real:
+			if (spec.realMin != -FLT_MAX || spec.realMax != FLT_MAX) {
+				printTo(printer, ": ", spec.realMin, "..", spec.realMax);
+			}
+			break;
+		case KPArgType::choice:
+			for (size_t i = 0; i < spec.choiceCount; i++) {
+				printTo(printer, i ? "|" : ": ", spec.choices[i]);
+			}
+			break;
+		case KPArgType::text:
+			break;
+		}
+
+		printTo(printer, ">");
+	}
+}  // namespace KPArgParser
+
+/**
+ * Converted arguments handed to a command handler. Indices start at the first argument after
+ * the command name. Values are only valid during the call.
+ */
+class KPArgs {
+private:
+	const KPArgValue * values;
+
+public:
+	KPArgs(const KPArgValue * values) : values(values) {}
+
+	long integer(size_t i) const {
+		return values[i].integer;
+	}
+
+	float real(size_t i) const {
+		return values[i].real;
+	}
+
+	// Index of the matched choice
+	size_t choice(size_t i) const {
+		return values[i].integer;
+	}
+
+	// Raw token, NUL terminated
+	const char * text(size_t i) const {
+		return values[i].text.c_str();
+	}
+};
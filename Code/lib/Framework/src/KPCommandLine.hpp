@@ -0,0 +1,129 @@
+#pragma once
+#include <KPFoundation.hpp>
+
+/**
+ * Non-owning view of a token inside a KPCommandLine buffer. Tokens are NUL terminated in place,
+ * so data can also be handed to C string functions. Valid until the next character is fed.
+ */
+struct KPStringView {
+	const char * data = "";
+	size_t size		  = 0;
+
+	KPStringView() = default;
+	KPStringView(const char * data, size_t size) : data(data), size(size) {}
+
+	const char * c_str() const {
+		return data;
+	}
+
+	bool operator==(const char * other) const {
+		return strncmp(data, other, size) == 0 && other[size] == 0;
+	}
+
+	bool operator!=(const char * other) const {
+		return !(*this == other);
+	}
+};
+
+/**
+ * Assembles characters into a fixed buffer and splits each complete line into whitespace
+ * separated tokens in place. No allocation and no copies: the tokens point into the buffer.
+ * A line longer than Capacity characters or with more than MaxTokens tokens is dropped whole
+ * and reported as such instead of being cut short.
+ *
+ * @tparam Capacity Longest accepted line, without the terminator
+ * @tparam MaxTokens Most tokens per line, command name included
+ */
+template <size_t Capacity = 128, size_t MaxTokens = 8>
+class KPCommandLine {
+public:
+	enum class Status : unsigned char { pending, complete, tooLong, tooManyTokens };
+
+private:
+	char buffer[Capacity + 1];
+	size_t length	 = 0;
+	bool overflowed	 = false;
+	KPStringView tokenViews[MaxTokens];
+	size_t tokenCount = 0;
+
+	Status tokenize() {
+		buffer[length] = 0;
+		tokenCount	   = 0;
+		for (size_t i = 0; i < length;) {
+			while (i < length && buffer[i] == ' ') {
+				buffer[i++] = 0;
+			}
+
+			if (i == length) {
+				break;
+			}
+
+			if (tokenCount == MaxTokens) {
+				tokenCount = 0;
+				return Status::tooManyTokens;
+			}
+
+			auto & token = tokenViews[tokenCount++];
+			token.data	 = buffer + i;
+			while (i < length && buffer[i] != ' ') {
+				i++;
+			}
+
+			token.size = buffer + i - token.data;
+		}
+
+		return Status::complete;
+	}
+
+public:
+	/**
+	 * Feed one received character
+	 *
+	 * @param c Character; control characters other than the newline are ignored
+	 * @return Status complete once a line with at least one token is ready in tokens()
+	 */
+	Status put(char c) {
+		if (c == '\n') {
+			auto status = Status::tooLong;
+			if (overflowed) {
+				tokenCount = 0;
+			} else {
+				status = tokenize();
+			}
+
+			length	   = 0;
+			overflowed = false;
+			if (status == Status::complete && tokenCount == 0) {
+				return Status::pending;
+			}
+
+			return status;
+		}
+
+		if (c < 32) {
+			return Status::pending;
+		}
+
+		if (length == Capacity) {
+			overflowed = true;
+		} else {
+			buffer[length++] = c;
+		}
+
+		return Status::pending;
+	}
+
+	// Drop the line received so far
+	void clear() {
+		length	   = 0;
+		overflowed = false;
+	}
+
+	const KPStringView * tokens() const {
+		return tokenViews;
+	}
+
+	size_t size() const {
+		return tokenCount;
+	}
+};
@@ -0,0 +1,179 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <array>
+
+/**
+ * Compile-time perfect hashing of a constexpr table keyed on names. A seed is searched at
+ * compile time so that FNV-1a(name, seed) % Slots differs for every entry; a Slots-sized array
+ * then maps each slot back to its entry. Both live in flash, and a lookup is one hash, one array
+ * read and one string compare.
+ *
+ * Everything here is C++11 constexpr, hence recursion instead of loops. The recursions are kept
+ * shallow (linear in the table size, logarithmic in the seed range) to stay well inside the
+ * compiler's constexpr depth limit.
+ */
+namespace KPPerfectHash {
+	constexpr uint32_t NO_SEED	  = 0xFFFFFFFF;
+	constexpr uint8_t NO_ENTRY	  = 0xFF;
+	constexpr uint32_t SEED_RANGE = 1 << 12;
+
+	constexpr uint32_t fnv1a(const char * s, uint32_t h) {
+		return *s ? fnv1a(s + 1, (h ^ static_cast<uint8_t>(*s)) * 16777619u) : h;
+	}
+
+	constexpr uint32_t slot(const char * name, uint32_t seed, size_t slots) {
+		return fnv1a(name, 2166136261u ^ seed) % slots;
+	}
+
+	// Same hash over a counted string, for lookups at runtime
+	inline uint32_t slot(const char * name, size_t size, uint32_t seed, size_t slots) {
+		uint32_t h = 2166136261u ^ seed;
+		for (size_t i = 0; i < size; i++) {
+			h = (h ^ static_cast<uint8_t>(name[i])) * 16777619u;
+		}
+
+		return h % slots;
+	}
+
+	template <typename Entry, size_t N>
+	constexpr bool collidesWith(
+		const Entry (&table)[N], uint32_t seed, size_t slots, size_t i, size_t j) {
+		return j < N
+			   && (slot(table[i].name, seed, slots) == slot(table[j].name, seed, slots)
+				   || collidesWith(table, seed, slots, i, j + 1));
+	}
+
+	template <typename Entry, size_t N>
+	constexpr bool collides(const Entry (&table)[N], uint32_t seed, size_t slots, size_t i = 0) {
+		return i < N
+			   && (collidesWith(table, seed, slots, i, i + 1)
+				   || collides(table, seed, slots, i + 1));
+	}
+
+	template <typename Entry, size_t N>
+	constexpr uint32_t findSeed(const Entry (&table)[N], size_t slots, uint32_t lo, uint32_t hi);
+
+	template <typename Entry, size_t N>
+	constexpr uint32_t orSeed(
+		uint32_t found, const Entry (&table)[N], size_t slots, uint32_t lo, uint32_t hi) {
+		return found != NO_SEED ? found : findSeed(table, slots, lo, hi);
+	}
+
+	/**
+	 * First seed in [lo, hi) without collisions, NO_SEED if there is none. Splits the range in
+	 * halves so the recursion depth is log2(hi - lo).
+	 */
+	template <typename Entry, size_t N>
+	constexpr uint32_t findSeed(const Entry (&table)[N], size_t slots, uint32_t lo, uint32_t hi) {
+		return hi - lo == 1 ? (collides(table, lo, slots) ? NO_SEED : lo)
+							: orSeed(findSeed(table, slots, lo, lo + (hi - lo) / 2), table, slots,
+								lo + (hi - lo) / 2, hi);
+	}
+
+	template <typename Entry, size_t N>
+	constexpr uint32_t findSeed(const Entry (&table)[N], size_t slots) {
+		return findSeed(table, slots, 0, SEED_RANGE);
+	}
+
+	template <typename Entry, size_t N>
+	constexpr uint8_t owner(
+		const Entry (&table)[N], uint32_t seed, size_t slots, size_t s, size_t i = 0) {
+		return i == N ? NO_ENTRY
+					  : slot(table[i].name, seed, slots) == s ? i
+															  : owner(table, seed, slots, s, i + 1);
+	}
+
+	// Hand-rolled index sequence (std::index_sequence is C++14); built by doubling
+	template <size_t... I>
+	struct Indices {};
+
+	template <typename A, typename B>
+	struct Concat;
+
+	template <size_t... A, size_t... B>
+	struct Concat<Indices<A...>, Indices<B...>> {
+		using type = Indices<A..., (sizeof...(A) + B)...>;
+	};
+
+	template <size_t N>
+	struct MakeIndices {
+		using type = typename Concat<typename MakeIndices<N / 2>::type,
+			typename MakeIndices<N - N / 2>::type>::type;
+	};
+
+	template <>
+	struct MakeIndices<0> {
+		using type = Indices<>;
+	};
+
+	template <>
+	struct MakeIndices<1> {
+		using type = Indices<0>;
+	};
+
+	template <typename Entry, size_t N, size_t... S>
+	constexpr std::array<uint8_t, sizeof...(S)> owners(
+		const Entry (&table)[N], uint32_t seed, Indices<S...>) {
+		return {{owner(table, seed, sizeof...(S), S)...}};
+	}
+}  // namespace KPPerfectHash
+
+/**
+ * Name lookup over a constexpr array of entries with a `const char * name` member. Declare the
+ * entries and the table constexpr so both end up in flash:
+ *
+ *     constexpr Command commands[] = {{"halt", halt}, ...};
+ *     constexpr auto seed = KPPerfectHash::findSeed(commands, 512);
+ *     static_assert(seed != KPPerfectHash::NO_SEED, "no perfect hash seed");
+ *     constexpr KPCommandTable<Command, sizeof(commands) / sizeof(commands[0]), 512> table(
+ *         commands, seed);
+ *
+ * @tparam Entry Entry type
+ * @tparam N Number of entries, at most 255
+ * @tparam Slots Hash range; about 10 times N keeps the seed search short
+ */
+template <typename Entry, size_t N, size_t Slots>
+class KPCommandTable {
+private:
+	static_assert(N < KPPerfectHash::NO_ENTRY, "Too many entries for 8-bit slot owners");
+
+	const Entry * entries;
+	uint32_t seed;
+	std::array<uint8_t, Slots> owners;
+
+public:
+	constexpr KPCommandTable(const Entry (&entries)[N], uint32_t seed)
+		: entries(entries),
+		  seed(seed),
+		  owners(KPPerfectHash::owners(
+			  entries, seed, typename KPPerfectHash::MakeIndices<Slots>::type())) {}
+
+	/**
+	 * Find the entry with the given name
+	 *
+	 * @param name Name, not necessarily NUL terminated
+	 * @param size Length of the name
+	 * @return const Entry* nullptr if there is no such entry
+	 */
+	const Entry * find(const char * name, size_t size) const {
+		auto index = owners[KPPerfectHash::slot(name, size, seed, Slots)];
+		if (index == KPPerfectHash::NO_ENTRY) {
+			return nullptr;
+		}
+
+		auto & entry = entries[index];
+		return strncmp(entry.name, name, size) == 0 && entry.name[size] == 0 ? &entry : nullptr;
+	}
+
+	const Entry * begin() const {
+		return entries;
+	}
+
+	const Entry * end() const {
+		return entries + N;
+	}
+
+	constexpr size_t size() const {
+		return N;
+	}
+};
@@ -14,6 +14,20 @@ public:
 		}
 	}
 
+	/**
+	 * Shortest idleTime() of the enabled components
+	 */
+	virtual unsigned long idleTime() {
+		unsigned long idle = IDLE_FOREVER;
+		for (auto & p : mapNameToComponent) {
+			if (p.second->enabled()) {
+				idle = std::min(idle, p.second->idleTime());
+			}
+		}
+
+		return idle;
+	}
+
 	void addComponent(KPComponent * c) {
 		if (mapNameToComponent.find(c->name) != mapNameToComponent.end()) {
 			halt(TRACE, c->name, " already exists");
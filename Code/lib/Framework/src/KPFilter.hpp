@@ -0,0 +1,142 @@
+#pragma once
+#include <KPFoundation.hpp>
+
+/**
+ * Streaming filters for sensor samples. Each stage takes one sample at a time with add(), in
+ * constant time, and returns its current output, which value() keeps for readers that want it
+ * later. KPFilterChain feeds the output of one stage into the next, so a whole pipeline is a
+ * single type:
+ *
+ *     KPFilterChain<KPMedianFilter<5>, KPEmaFilter> filter{{}, KPEmaFilter(25)};
+ *     filter.add(sample);
+ *     filter.value();            // smoothed, spikes removed
+ *     filter.second.variance();  // spread of the despiked samples
+ */
+
+/**
+ * Running median of the last N samples. Rejects spikes shorter than N / 2 + 1 samples while
+ * passing steps through after N / 2 samples. Sorting a window of fixed N keeps each sample O(1).
+ *
+ * @tparam N Window length, odd
+ */
+template <size_t N>
+class KPMedianFilter {
+private:
+	static_assert(N % 2 == 1, "Median window must be odd");
+
+	float window[N];
+	size_t next	  = 0;
+	size_t filled = 0;
+	float median  = 0;
+
+public:
+	float add(float sample) {
+		window[next] = sample;
+		next		 = (next + 1) % N;
+		if (filled < N) {
+			filled++;
+		}
+
+		float sorted[N];
+		for (size_t i = 0; i < filled; i++) {
+			size_t j = i;
+			for (; j > 0 && sorted[j - 1] > window[i]; j--) {
+				sorted[j] = sorted[j - 1];
+			}
+
+			sorted[j] = window[i];
+		}
+
+		median = sorted[filled / 2];
+		return median;
+	}
+
+	float value() const {
+		return median;
+	}
+
+	void reset() {
+		next   = 0;
+		filled = 0;
+		median = 0;
+	}
+};
+
+/**
+ * Exponential moving average with the exponentially weighted variance of its input. The span
+ * sets the smoothing in samples (alpha = 2 / (span + 1)), so the same span follows the signal
+ * faster at a higher sample rate. The first sample seeds the average, so there is no ramp up
+ * from zero.
+ */
+class KPEmaFilter {
+private:
+	float alpha;
+	float mean		 = 0;
+	float spread	 = 0;
+	uint32_t samples = 0;
+
+public:
+	/**
+	 * @param span Number of samples the average roughly spans, at least 1
+	 */
+	KPEmaFilter(float span) : alpha(2 / (span + 1)) {}
+
+	float add(float sample) {
+		if (samples++ == 0) {
+			mean   = sample;
+			spread = 0;
+			return mean;
+		}
+
+		float difference = sample - mean;
+		float step		 = alpha * difference;
+		mean += step;
+		spread = (1 - alpha) * (spread + difference * step);
+		return mean;
+	}
+
+	float value() const {
+		return mean;
+	}
+
+	float variance() const {
+		return spread;
+	}
+
+	// Samples since the last reset
+	uint32_t count() const {
+		return samples;
+	}
+
+	void reset() {
+		mean	= 0;
+		spread	= 0;
+		samples = 0;
+	}
+};
+
+/**
+ * Two stages in series; nest chains for longer pipelines. The stages stay accessible for their
+ * own statistics.
+ */
+template <typename First, typename Second>
+class KPFilterChain {
+public:
+	First first;
+	Second second;
+
+	KPFilterChain(First first, Second second) : first(first), second(second) {}
+
+	float add(float sample) {
+		return second.add(first.add(sample));
+	}
+
+	float value() const {
+		return second.value();
+	}
+
+	void reset() {
+		first.reset();
+		second.reset();
+	}
+};
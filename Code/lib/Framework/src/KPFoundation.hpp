@@ -10,6 +10,66 @@
 
 extern "C" char * sbrk(int i);
 
+// Returned by idleTime() when nothing is pending
+constexpr unsigned long IDLE_FOREVER = 0xFFFFFFFFUL;
+
+// Time the MCU spent in sleep modes where millis() stops counting
+inline uint64_t & sleptMillis() {
+	static uint64_t ms = 0;
+	return ms;
+}
+
+// Uncorrected 64-bit milliseconds since boot, counting time spent asleep. Extends millis() past
+// its 49-day rollover, so it must be called at least that often (the main loop does) and only
+// from the main loop, never from an interrupt handler.
+inline uint64_t rawUptimeMillis() {
+	static uint32_t last = 0;
+	static uint64_t high = 0;
+	uint32_t ms			 = millis();
+	if (ms < last) {
+		high += 1ULL << 32;
+	}
+
+	last = ms;
+	return high + ms + sleptMillis();
+}
+
+// Rate correction applied to the raw timebase from the point it was last changed
+struct TimebaseCorrection {
+	long ppb		   = 0;	 // positive when the raw timebase runs fast
+	uint64_t raw	   = 0;
+	uint64_t corrected = 0;
+
+	uint64_t apply(uint64_t now) const {
+		auto elapsed = now - raw;
+		return corrected + elapsed - (int64_t) elapsed * ppb / 1000000000LL;
+	}
+};
+
+inline TimebaseCorrection & timebaseCorrection() {
+	static TimebaseCorrection correction;
+	return correction;
+}
+
+// Framework time base: rate-corrected, monotonic milliseconds since boot. Use it for anything
+// that has to keep counting across standby.
+inline uint64_t uptimeMillis() {
+	return timebaseCorrection().apply(rawUptimeMillis());
+}
+
+/**
+ * Rescale uptimeMillis() from now on. The time base stays continuous and monotonic.
+ *
+ * @param ppb Rate error of the raw timebase in parts per billion, positive when it runs fast
+ */
+inline void setTimebaseCorrection(long ppb) {
+	auto & c	= timebaseCorrection();
+	auto now	= rawUptimeMillis();
+	c.corrected = c.apply(now);
+	c.raw		= now;
+	c.ppb		= ppb;
+}
+
 class KPController;
 class KPComponent {
 public:
@@ -26,6 +86,16 @@ public:
 
 	virtual void setup(){};
 	virtual void update(){};
+
+	/**
+	 * How long this component can go without update() before it has work to do. Components
+	 * that only act when called into have nothing pending, hence the default.
+	 *
+	 * @return unsigned long Milliseconds, 0 to keep looping or IDLE_FOREVER
+	 */
+	virtual unsigned long idleTime() {
+		return IDLE_FOREVER;
+	}
 };
 
 //
@@ -34,11 +104,26 @@ public:
 // ────────────────────────────────────────────────────────────
 //
 
+// Write val in decimal ending just before end; returns the first character. Allocation free.
+inline char * formatUnsigned(char * end, uint64_t val) {
+	*--end = 0;
+	do {
+		*--end = '0' + val % 10;
+		val /= 10;
+	} while (val);
+	return end;
+}
+
 // Overload unsupported types here...
 inline size_t printTo(Print & printer, time_t val) {
 	return printer.print((long) val);
 }
 
+inline size_t printTo(Print & printer, uint64_t val) {
+	char buffer[21];
+	return printer.print(formatUnsigned(buffer + sizeof(buffer), val));
+}
+
 template <typename T0, typename T1>
 size_t printTo(Print & printer, std::pair<T0, T1> val) {
 	using namespace std;
@@ -65,24 +150,272 @@ Print & operator<<(Print & printer, T && val) {
 	return printer;
 }
 
+// Bytes of serial output that can be queued; override with a build flag
+#ifndef KP_SERIAL_OUTPUT_CAPACITY
+	#define KP_SERIAL_OUTPUT_CAPACITY 1024
+#endif
+
+// Most bytes handed to Serial per update(); one USB full-speed bulk packet by default
+#ifndef KP_SERIAL_DRAIN_CHUNK
+	#define KP_SERIAL_DRAIN_CHUNK 64
+#endif
+
+/**
+ * Ring buffer in front of Serial. print() and println() write into it and update() hands it to
+ * the USB driver one packet per pass. The SAMD CDC driver reports the same free space whatever
+ * the host is doing and holds a write until the host has taken the packet, so each pass can still
+ * wait for the host, but for one packet at most rather than a whole burst of output. Without a
+ * host on the port, as on battery, output is discarded rather than queued.
+ *
+ * A single write() is queued whole or not at all. A print() or println() call writes once per
+ * value, so they group their writes with beginGroup() and endGroup() and a full buffer drops the
+ * whole call rather than its tail. Print calls made directly on the instance are not grouped.
+ */
+class KPSerialOutput : public Print, public KPComponent {
+public:
+	// What happens to output that does not fit: dropped silently, or dropped and reported with a
+	// note in the output once there is room again
+	enum class Overflow : unsigned char { drop, count };
+
+private:
+	uint8_t buffer[KP_SERIAL_OUTPUT_CAPACITY];
+	size_t head	   = 0;
+	size_t length  = 0;
+	size_t pending = 0;	 // dropped but not reported yet
+
+	// Writes inside a group are staged past the queued bytes until the outermost endGroup()
+	uint8_t groupDepth = 0;
+	size_t staged	   = 0;
+	bool groupCut	   = false;
+	bool stalled	   = false;	 // the driver took nothing on the last drain
+
+	uint8_t * capture	   = nullptr;
+	size_t captureCapacity = 0;
+	size_t captured		   = 0;
+	bool captureCut		   = false;
+
+	void reportDropped() {
+		char note[40] = "\r\n[dropped ";
+		char digits[21];
+		strcat(note, formatUnsigned(digits + sizeof(digits), pending));
+		strcat(note, " bytes]\r\n");
+		if (strlen(note) <= KP_SERIAL_OUTPUT_CAPACITY - length) {
+			write(reinterpret_cast<const uint8_t *>(note), strlen(note));
+			pending = 0;
+		}
+	}
+
+	// Hand up to one packet to Serial; returns false when the driver took nothing
+	bool drain() {
+		if (!hostListening()) {
+			head   = (head + length) % KP_SERIAL_OUTPUT_CAPACITY;
+			length = 0;
+		}
+
+		int room = Serial.availableForWrite();
+		if (length == 0 || room <= 0) {
+			stalled = length > 0;
+			return false;
+		}
+
+		size_t chunk = std::min({length, KP_SERIAL_OUTPUT_CAPACITY - head, size_t(room),
+			size_t(KP_SERIAL_DRAIN_CHUNK)});
+		chunk		 = Serial.write(buffer + head, chunk);
+		head		 = (head + chunk) % KP_SERIAL_OUTPUT_CAPACITY;
+		length -= chunk;
+		stalled = chunk == 0;
+		return chunk > 0;
+	}
+
+public:
+	Overflow overflow = Overflow::count;
+	// Bytes dropped since boot
+	unsigned long dropped = 0;
+
+	using KPComponent::KPComponent;
+	using Print::write;
+
+	size_t write(const uint8_t * data, size_t size) override {
+		if (capture) {
+			size_t room = std::min(size, captureCapacity - captured);
+			memcpy(capture + captured, data, room);
+			captured += room;
+			captureCut |= room < size;
+			return size;
+		}
+
+		if (!hostListening()) {
+			return 0;
+		}
+
+		if (groupCut || size > KP_SERIAL_OUTPUT_CAPACITY - length - staged) {
+			groupCut = groupDepth > 0;
+			dropped += size;
+			if (overflow == Overflow::count) {
+				pending += size;
+			}
+
+			return 0;
+		}
+
+		size_t tail	 = (head + length + staged) % KP_SERIAL_OUTPUT_CAPACITY;
+		size_t first = std::min(size, KP_SERIAL_OUTPUT_CAPACITY - tail);
+		memcpy(buffer + tail, data, first);
+		memcpy(buffer, data + first, size - first);
+		if (groupDepth) {
+			staged += size;
+		} else {
+			length += size;
+		}
+
+		return size;
+	}
+
+	size_t write(uint8_t c) override {
+		return write(&c, 1);
+	}
+
+	// Free space; a write of at most this many bytes is queued
+	int availableForWrite() override {
+		if (capture) {
+			return captureCapacity - captured;
+		}
+
+		return hostListening() ? KP_SERIAL_OUTPUT_CAPACITY - length - staged : 0;
+	}
+
+	/**
+	 * Queue the writes up to the matching endGroup() together: all of them, or none if one does
+	 * not fit. Groups nest; only the outermost one queues.
+	 */
+	void beginGroup() {
+		groupDepth++;
+	}
+
+	/**
+	 * @return false if the group was dropped
+	 */
+	bool endGroup() {
+		bool kept = !groupCut;
+		if (--groupDepth > 0) {
+			return kept;
+		}
+
+		if (kept) {
+			length += staged;
+		} else {
+			dropped += staged;
+			if (overflow == Overflow::count) {
+				pending += staged;
+			}
+		}
+
+		staged	 = 0;
+		groupCut = false;
+		return kept;
+	}
+
+	/**
+	 * Collect the output in a buffer instead of sending it, e.g. to return a command's output
+	 * inside a binary reply rather than as text between the frames. Output past the end of the
+	 * buffer is cut off.
+	 *
+	 * @param into Buffer for the output
+	 * @param capacity Size of the buffer
+	 */
+	void beginCapture(uint8_t * into, size_t capacity) {
+		capture			= into;
+		captureCapacity = capacity;
+		captured		= 0;
+		captureCut		= false;
+	}
+
+	/**
+	 * Send output again
+	 *
+	 * @param cut Set if output was cut off
+	 * @return size_t Bytes collected
+	 */
+	size_t endCapture(bool & cut) {
+		capture = nullptr;
+		cut		= captureCut;
+		return captured;
+	}
+
+	void update() override {
+		drain();
+		if (pending) {
+			reportDropped();
+		}
+	}
+
+	// Poll again soon while the driver is taking output; the driver frees up space every USB
+	// frame. Once it stops taking any, the USB interrupts wake the loop instead.
+	unsigned long idleTime() override {
+		return length && !stalled ? 1 : IDLE_FOREVER;
+	}
+
+	/**
+	 * A host has the CDC port open. Without one the driver accepts nothing, so output is not
+	 * queued at all and whatever was queued is discarded, as Serial would; otherwise the queue
+	 * would never empty and keep the MCU out of standby.
+	 */
+	static bool hostListening() {
+#ifdef USBCON
+		return USBDevice.configured() && Serial.dtr();
+#else
+		return true;
+#endif
+	}
+
+	/**
+	 * Block until everything queued has been handed to the driver, or the driver stopped taking
+	 * output for timeout milliseconds (no host listening)
+	 */
+	void flush(unsigned long timeout) {
+		unsigned long start = millis();
+		while (length && millis() - start < timeout) {
+			if (drain()) {
+				start = millis();
+			}
+		}
+	}
+
+	void flush() override {
+		flush(100);
+	}
+
+	static KPSerialOutput & sharedInstance() {
+		static KPSerialOutput output("shared-serial-output");
+		return output;
+	}
+};
+
 // ────────────────────────────────────────────────────────────────────────────────
-// Output to Serial
+// Output to Serial, queued in KPSerialOutput
 // ────────────────────────────────────────────────────────────────────────────────
 template <typename... Types>
 size_t print(Types &&... values) {
-	return printTo(Serial, std::forward<Types>(values)...);
+	auto & out = KPSerialOutput::sharedInstance();
+	out.beginGroup();
+	size_t size = printTo(out, std::forward<Types>(values)...);
+	return out.endGroup() ? size : 0;
 }
 
 inline size_t println() {
-	return Serial.println();
+	return KPSerialOutput::sharedInstance().println();
 }
 
 template <typename... Types>
 size_t println(Types... values) {
-	return print(std::forward<Types>(values)...) + println();
+	auto & out = KPSerialOutput::sharedInstance();
+	out.beginGroup();
+	size_t size = print(std::forward<Types>(values)...) + println();
+	return out.endGroup() ? size : 0;
 }
 
 [[noreturn]] inline void halt() {
+	KPSerialOutput::sharedInstance().flush();
 	while (true) {}
 }
 
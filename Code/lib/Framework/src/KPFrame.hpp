@@ -0,0 +1,238 @@
+#pragma once
+#include <KPFoundation.hpp>
+
+/**
+ * Binary frames for talking to a host program over the same serial port as the text shell.
+ *
+ * A frame is a payload followed by its CRC-16/CCITT (little endian), COBS encoded so that it
+ * contains no zero byte, and written between two zero bytes: 00 <encoded payload + crc> 00.
+ * Text never contains a zero byte, so a reader on either side can tell frames from text by the
+ * leading delimiter.
+ */
+namespace KPFrame {
+	// Longest payload, CRC excluded; keeps the encoded frame within one COBS block
+	constexpr size_t MAX_PAYLOAD = 250;
+	constexpr uint8_t DELIMITER	 = 0;
+	// Longest frame on the wire: CRC, COBS overhead and both delimiters
+	constexpr size_t MAX_FRAME = MAX_PAYLOAD + 5;
+	// Longest gap between two bytes of one frame, in ms; a reader gives up on the frame after it
+	constexpr unsigned long BYTE_TIMEOUT = 100;
+
+	inline uint16_t crc16(const uint8_t * data, size_t size, uint16_t crc = 0xFFFF) {
+		while (size--) {
+			crc ^= static_cast<uint16_t>(*data++) << 8;
+			for (int i = 0; i < 8; i++) {
+				crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+			}
+		}
+
+		return crc;
+	}
+
+	/**
+	 * COBS encode
+	 *
+	 * @param in Data to encode
+	 * @param size Length of the data
+	 * @param out At least size + size / 254 + 1 bytes
+	 * @return size_t Encoded length
+	 */
+	inline size_t encode(const uint8_t * in, size_t size, uint8_t * out) {
+		size_t code = 0;
+		size_t o	= 1;
+		out[code]	= 1;
+		for (size_t i = 0; i < size; i++) {
+			if (in[i] != 0) {
+				out[o++] = in[i];
+				out[code]++;
+			}
+
+			if (in[i] == 0 || out[code] == 0xFF) {
+				code	  = o++;
+				out[code] = 1;
+			}
+		}
+
+		return o;
+	}
+
+	/**
+	 * COBS decode in place; the decoded data is never longer than the encoded
+	 *
+	 * @param data Encoded frame without delimiters
+	 * @param size Length of the encoded frame
+	 * @return size_t Decoded length, 0 if the frame is malformed
+	 */
+	inline size_t decode(uint8_t * data, size_t size) {
+		size_t o = 0;
+		for (size_t i = 0; i < size;) {
+			uint8_t code = data[i++];
+			if (code == 0 || i + code - 1 > size) {
+				return 0;
+			}
+
+			for (uint8_t j = 1; j < code; j++) {
+				data[o++] = data[i++];
+			}
+
+			if (code != 0xFF && i < size) {
+				data[o++] = 0;
+			}
+		}
+
+		return o;
+	}
+
+	/**
+	 * Append the CRC, encode and add the delimiters, ready to be written
+	 *
+	 * @param payload Payload of at most MAX_PAYLOAD bytes
+	 * @param size Length of the payload
+	 * @param frame At least MAX_FRAME bytes
+	 * @return size_t Frame length, 0 if the payload is too long
+	 */
+	inline size_t pack(const uint8_t * payload, size_t size, uint8_t * frame) {
+		if (size > MAX_PAYLOAD) {
+			return 0;
+		}
+
+		uint8_t raw[MAX_PAYLOAD + 2];
+		memcpy(raw, payload, size);
+		auto crc	  = crc16(payload, size);
+		raw[size]	  = crc & 0xFF;
+		raw[size + 1] = crc >> 8;
+
+		frame[0]		= DELIMITER;
+		auto length		= encode(raw, size + 2, frame + 1) + 1;
+		frame[length++] = DELIMITER;
+		return length;
+	}
+
+	/**
+	 * Pack and write one frame
+	 *
+	 * @param out Destination, usually Serial
+	 * @param payload Payload of at most MAX_PAYLOAD bytes
+	 * @param size Length of the payload
+	 * @return size_t Bytes written, 0 if the payload is too long
+	 */
+	inline size_t send(Print & out, const uint8_t * payload, size_t size) {
+		uint8_t frame[MAX_FRAME];
+		auto length = pack(payload, size, frame);
+		return length ? out.write(frame, length) : 0;
+	}
+
+	/**
+	 * Check and strip the CRC of a decoded frame
+	 *
+	 * @return size_t Payload length, 0 if the CRC does not match
+	 */
+	inline size_t verify(const uint8_t * data, size_t size) {
+		if (size < 2) {
+			return 0;
+		}
+
+		size -= 2;
+		uint16_t crc = data[size] | data[size + 1] << 8;
+		return crc16(data, size) == crc ? size : 0;
+	}
+
+	// Little endian field helpers for building and reading payloads
+	class Writer {
+	private:
+		uint8_t * data;
+		size_t capacity;
+		size_t length = 0;
+
+	public:
+		Writer(uint8_t * data, size_t capacity) : data(data), capacity(capacity) {}
+
+		Writer & bytes(const void * value, size_t size) {
+			if (length + size <= capacity) {
+				memcpy(data + length, value, size);
+			}
+
+			length += size;
+			return *this;
+		}
+
+		Writer & u8(uint8_t value) {
+			return bytes(&value, 1);
+		}
+
+		Writer & u16(uint16_t value) {
+			return bytes(&value, 2);
+		}
+
+		Writer & u32(uint32_t value) {
+			return bytes(&value, 4);
+		}
+
+		Writer & f32(float value) {
+			return bytes(&value, 4);
+		}
+
+		// Zero terminated
+		Writer & text(const char * value) {
+			return bytes(value, strlen(value) + 1);
+		}
+
+		// False if anything was cut off
+		bool ok() const {
+			return length <= capacity;
+		}
+
+		size_t size() const {
+			return length;
+		}
+	};
+
+	class Reader {
+	private:
+		const uint8_t * data;
+		size_t length;
+		size_t position = 0;
+
+	public:
+		Reader(const uint8_t * data, size_t length) : data(data), length(length) {}
+
+		bool bytes(void * value, size_t size) {
+			if (position + size > length) {
+				return false;
+			}
+
+			memcpy(value, data + position, size);
+			position += size;
+			return true;
+		}
+
+		bool u8(uint8_t & value) {
+			return bytes(&value, 1);
+		}
+
+		bool i32(int32_t & value) {
+			return bytes(&value, 4);
+		}
+
+		bool f32(float & value) {
+			return bytes(&value, 4);
+		}
+
+		// Zero terminated text, left in place
+		bool text(const char *& value, size_t & size) {
+			auto end = static_cast<const uint8_t *>(memchr(data + position, 0, length - position));
+			if (!end) {
+				return false;
+			}
+
+			value = reinterpret_cast<const char *>(data + position);
+			size  = end - (data + position);
+			position += size + 1;
+			return true;
+		}
+
+		bool done() const {
+			return position == length;
+		}
+	};
+}  // namespace KPFrame
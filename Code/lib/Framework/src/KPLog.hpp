@@ -0,0 +1,68 @@
+#pragma once
+#include <KPFoundation.hpp>
+
+/**
+ * Leveled logging with a compile-time ceiling and a runtime level per module.
+ *
+ * The application lists its modules in a LogModule namespace: an id per module
+ * (LogModule::LOAD), LogModule::NAMES and a KP_LOG_MAX_<module> macro for the ceiling. Then
+ *
+ *     LOG_DEBUG(LOAD, "Load reading;", i, ";", reading);
+ *
+ * evaluates its arguments only when DEBUG is within both the ceiling and the module's runtime
+ * level. A level above the ceiling is a constant false condition, so the whole statement,
+ * arguments included, is compiled out while still being type checked.
+ */
+#define KP_LOG_OFF	 0
+#define KP_LOG_ERROR 1
+#define KP_LOG_WARN	 2
+#define KP_LOG_INFO	 3
+#define KP_LOG_DEBUG 4
+#define KP_LOG_TRACE 5
+
+// Default ceiling for modules that do not set their own
+#ifndef KP_LOG_MAX
+	#define KP_LOG_MAX KP_LOG_INFO
+#endif
+
+namespace KPLog {
+	constexpr size_t MAX_MODULES		  = 16;
+	constexpr const char * LEVEL_NAMES[] = {"off", "error", "warn", "info", "debug", "trace"};
+	constexpr const char LEVEL_TAGS[]	  = "-EWIDT";
+
+	// Runtime level of each module. Starts fully open, so the ceilings alone decide until a level
+	// is lowered at runtime.
+	inline uint8_t & level(size_t module) {
+		static struct Levels {
+			uint8_t values[MAX_MODULES];
+			Levels() {
+				memset(values, KP_LOG_TRACE, sizeof(values));
+			}
+		} levels;
+
+		return levels.values[module];
+	}
+
+	// One line: "[D load] values..."
+	template <typename... Types>
+	void write(const char * module, int level, Types &&... values) {
+		auto & out = KPSerialOutput::sharedInstance();
+		out.beginGroup();
+		print("[", LEVEL_TAGS[level], " ", module, "] ");
+		println(std::forward<Types>(values)...);
+		out.endGroup();
+	}
+}  // namespace KPLog
+
+#define KP_LOG(module, lvl, ...)                                                                 \
+	do {                                                                                           \
+		if ((lvl) <= KP_LOG_MAX_##module && (lvl) <= KPLog::level(LogModule::module)) {           \
+			KPLog::write(LogModule::NAMES[LogModule::module], lvl, __VA_ARGS__);                  \
+		}                                                                                          \
+	} while (0)
+
+#define LOG_ERROR(module, ...) KP_LOG(module, KP_LOG_ERROR, __VA_ARGS__)
+#define LOG_WARN(module, ...)  KP_LOG(module, KP_LOG_WARN, __VA_ARGS__)
+#define LOG_INFO(module, ...)  KP_LOG(module, KP_LOG_INFO, __VA_ARGS__)
+#define LOG_DEBUG(module, ...) KP_LOG(module, KP_LOG_DEBUG, __VA_ARGS__)
+#define LOG_TRACE(module, ...) KP_LOG(module, KP_LOG_TRACE, __VA_ARGS__)
@@ -0,0 +1,84 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <atomic>
+
+/**
+ * Lock-free single-producer single-consumer ring, for handing data from an interrupt handler to
+ * the main loop. Only the producer writes head and only the consumer writes tail, so neither
+ * side ever has to disable interrupts. Both indices count up freely and are masked on access;
+ * their difference is the fill level. On a single core, compiler fences are all the ordering
+ * the two sides need.
+ *
+ * A full ring refuses the new item and counts an overrun instead of overwriting the oldest,
+ * which the producer could not do without racing the consumer.
+ *
+ * @tparam T Item type, copied in and out
+ * @tparam N Capacity, a power of two
+ */
+template <typename T, size_t N>
+class KPRing {
+private:
+	static_assert(N > 0 && (N & (N - 1)) == 0, "Ring capacity must be a power of two");
+
+	T items[N];
+	volatile uint32_t head	   = 0;
+	volatile uint32_t tail	   = 0;
+	volatile uint32_t overflow = 0;
+
+public:
+	/**
+	 * Producer side: append an item
+	 *
+	 * @return false if the ring is full; the item is dropped and counted in overruns()
+	 */
+	bool push(const T & item) {
+		uint32_t h = head;
+		if (h - tail == N) {
+			overflow = overflow + 1;
+			return false;
+		}
+
+		items[h & (N - 1)] = item;
+		// The item must be in place before the consumer can see the new head
+		std::atomic_signal_fence(std::memory_order_release);
+		head = h + 1;
+		return true;
+	}
+
+	/**
+	 * Consumer side: take the oldest item
+	 *
+	 * @return false if the ring is empty
+	 */
+	bool pop(T & item) {
+		uint32_t t = tail;
+		if (head == t) {
+			return false;
+		}
+
+		std::atomic_signal_fence(std::memory_order_acquire);
+		item = items[t & (N - 1)];
+		// Copy the item out before handing its slot back to the producer
+		std::atomic_signal_fence(std::memory_order_release);
+		tail = t + 1;
+		return true;
+	}
+
+	// Consumer side: drop everything pushed so far
+	void clear() {
+		tail = head;
+	}
+
+	size_t size() const {
+		return head - tail;
+	}
+
+	constexpr size_t capacity() const {
+		return N;
+	}
+
+	// Items refused because the ring was full
+	uint32_t overruns() const {
+		return overflow;
+	}
+};
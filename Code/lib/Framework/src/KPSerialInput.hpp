@@ -2,31 +2,121 @@
 #include <KPFoundation.hpp>
 #include <KPSubject.hpp>
 #include <KPSerialInputObserver.hpp>
-#include <vector>
+#include <KPCommandLine.hpp>
+#include <KPFrame.hpp>
 
+/**
+ * Reads command lines and binary frames from Serial. The USB CDC driver already receives into
+ * its own buffer from the USB interrupt; this assembles lines out of it without copying them
+ * again. A zero byte switches to frame mode until the zero that ends a non-empty frame. A stray
+ * zero, from line noise or a terminal's Ctrl-@, must not lock out the text shell, so frame mode
+ * also ends on a newline right after the zero, on overflow, and after a gap of
+ * KPFrame::BYTE_TIMEOUT between two bytes.
+ */
 class KPSerialInput : public KPComponent, public KPSubject<KPSerialInputObserver> {
 private:
-	KPStringBuilder<255> input;
+	KPCommandLine<> input;
+
+	uint8_t frame[KPFrame::MAX_FRAME];
+	size_t frameLength		 = 0;
+	bool inFrame			 = false;
+	unsigned long lastByteAt = 0;
+
+	// Back to text; a partial frame counts as dropped
+	void leaveFrame() {
+		if (frameLength > 0) {
+			droppedFrames++;
+		}
+
+		frameLength = 0;
+		inFrame		= false;
+	}
+
+	// Returns true once a frame has been handed to the observers
+	bool putFrameByte(uint8_t c) {
+		if (c == '\n' && frameLength == 0) {
+			leaveFrame();
+			return false;
+		}
+
+		if (c != KPFrame::DELIMITER) {
+			if (frameLength < sizeof(frame)) {
+				frame[frameLength++] = c;
+			} else {
+				leaveFrame();
+			}
+
+			return false;
+		}
+
+		// Back to back delimiters: the previous one closed nothing, this one opens the frame
+		if (frameLength == 0) {
+			return false;
+		}
+
+		size_t size = KPFrame::verify(frame, KPFrame::decode(frame, frameLength));
+		frameLength = 0;
+		inFrame		= false;
+		if (size == 0) {
+			droppedFrames++;
+			return false;
+		}
+
+		updateObservers(&KPSerialInputObserver::frameReceived, frame, size);
+		return true;
+	}
 
 public:
+	// Frames discarded for a bad CRC, bad encoding or overflow
+	unsigned long droppedFrames = 0;
+
 	using KPComponent::KPComponent;
 
+	// Handles at most one line or frame per call so a burst of input cannot hold up the loop
 	void update() {
 		while (Serial.available() > 0) {
-			char inputChar = Serial.read();
-			if (inputChar == '\n') {
-				updateObservers(&KPSerialInputObserver::commandReceived, input, input.size());
+			uint8_t c = Serial.read();
+			if (inFrame && millis() - lastByteAt > KPFrame::BYTE_TIMEOUT) {
+				leaveFrame();
+			}
+
+			lastByteAt = millis();
+
+			if (inFrame) {
+				if (putFrameByte(c)) {
+					return;
+				}
+
+				continue;
+			}
+
+			if (c == KPFrame::DELIMITER) {
+				inFrame = true;
 				input.clear();
-				return;
+				continue;
 			}
 
-			// Ignore System characters
-			if (inputChar >= 32) {
-				input.print(inputChar);
+			switch (input.put(c)) {
+			case decltype(input)::Status::pending:
+				continue;
+			case decltype(input)::Status::complete:
+				updateObservers(
+					&KPSerialInputObserver::commandReceived, input.tokens(), input.size());
+				return;
+			case decltype(input)::Status::tooLong:
+				println("Error: line too long");
+				return;
+			case decltype(input)::Status::tooManyTokens:
+				println("Error: too many arguments");
+				return;
 			}
 		}
 	}
 
+	unsigned long idleTime() override {
+		return Serial.available() > 0 ? 0 : IDLE_FOREVER;
+	}
+
 	static KPSerialInput & sharedInstance() {
 		static KPSerialInput serial("shared-serial-input");
 		return serial;
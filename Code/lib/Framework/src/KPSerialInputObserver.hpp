@@ -1,6 +1,7 @@
 #pragma once
 #include <KPFoundation.hpp>
 #include <KPObserver.hpp>
+#include <KPCommandLine.hpp>
 
 class KPSerialInputObserver : public KPObserver {
 public:
@@ -11,5 +12,19 @@ public:
 	virtual const char * KPSerialInputObserverName() const {
 		return "<Unnamed> Serial Input Observer";
 	}
-	virtual void commandReceived(const char * line, size_t size) = 0;
+	/**
+	 * A complete command line arrived
+	 *
+	 * @param args Whitespace separated tokens, args[0] being the command name
+	 * @param count Number of tokens, at least 1
+	 */
+	virtual void commandReceived(const KPStringView * args, size_t count) = 0;
+
+	/**
+	 * A binary frame with a valid CRC arrived (see KPFrame.hpp)
+	 *
+	 * @param payload Decoded payload, CRC stripped; valid during the call
+	 * @param size Length of the payload, at least 1
+	 */
+	virtual void frameReceived(const uint8_t * payload, size_t size) {}
 };
\ No newline at end of file
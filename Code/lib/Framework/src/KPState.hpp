@@ -7,13 +7,20 @@ struct KPStateSchedule {
 private:
 	bool activated = false;
 	friend class KPStateMachine;
+	friend class KPState;
 
 public:
 	std::function<bool()> condition;
 	std::function<void()> callback;
-	KPStateSchedule(std::function<bool()> condition, std::function<void()> callback)
+	// Milliseconds after entering the state at which a time condition fires; IDLE_FOREVER for
+	// conditions that have to be polled
+	unsigned long timeout = IDLE_FOREVER;
+
+	KPStateSchedule(std::function<bool()> condition, std::function<void()> callback,
+		unsigned long timeout = IDLE_FOREVER)
 		: condition(condition),
-		  callback(callback) {}
+		  callback(callback),
+		  timeout(timeout) {}
 };
 
 class KPStateMachine;
@@ -22,13 +29,13 @@ class KPState {
 
 protected:
 	const char * name		 = nullptr;
-	unsigned long startTime	 = 0;
+	uint64_t startTime		 = 0;
 	bool didEnter			 = false;
 	size_t numberOfSchedules = 0;
 	std::vector<KPStateSchedule> schedules;
 
 	void begin() {
-		startTime		  = millis();
+		startTime		  = uptimeMillis();
 		numberOfSchedules = 0;
 		didEnter		  = false;
 	}
@@ -79,7 +86,33 @@ public:
 	 * @return unsigned long
 	 */
 	unsigned long timeSinceLastTransition() const {
-		return millis() - startTime;
+		return uptimeMillis() - startTime;
+	}
+
+	/**
+	 * How long the state machine can go without update() while in this state. Only time
+	 * conditions can be predicted; any other condition needs polling. States that override
+	 * update() to sample something continuously should override this to return 0.
+	 *
+	 * @return unsigned long Milliseconds until the earliest pending time condition
+	 */
+	virtual unsigned long idleTime() const {
+		unsigned long idle = IDLE_FOREVER;
+		auto elapsed	   = timeSinceLastTransition();
+		for (size_t i = 0; i < numberOfSchedules; i++) {
+			auto & s = schedules[i];
+			if (s.activated) {
+				continue;
+			}
+
+			if (s.timeout == IDLE_FOREVER || elapsed >= s.timeout) {
+				return 0;
+			}
+
+			idle = std::min(idle, s.timeout - elapsed);
+		}
+
+		return idle;
 	}
 
 	/**
@@ -91,6 +124,7 @@ public:
 	void setTimeCondition(unsigned long seconds, std::function<void()> callback) {
 		auto millis = secsToMillis(seconds);
 		setCondition([this, millis]() { return timeSinceLastTransition() >= millis; }, callback);
+		schedules[numberOfSchedules - 1].timeout = millis;
 	}
 
 	/**
@@ -28,6 +28,14 @@ void KPStateMachine::update() {
 	currentState->update(*this);
 }
 
+unsigned long KPStateMachine::idleTime() {
+	if (!currentState) {
+		return IDLE_FOREVER;
+	}
+
+	return currentState->didEnter ? currentState->idleTime() : 0;
+}
+
 void KPStateMachine::next(int code) const {
 	auto entry = mapNameToMiddleware.find(currentState->name);
 	if (entry != mapNameToMiddleware.end()) {
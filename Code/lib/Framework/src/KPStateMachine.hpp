@@ -99,6 +99,11 @@ public:
 	 */
 	void next(int code = 0) const;
 
+	/**
+	 * Idle time of the current state; 0 until the state has been entered
+	 */
+	unsigned long idleTime() override;
+
 	/**
 	 * Restart the state by passing the currentState name to transitionTo(name)
 	 */
@@ -4,34 +4,37 @@
 // https://en.cppreference.com/w/cpp/language/parameter_pack
 #pragma once
 #include <KPFoundation.hpp>
-#include <functional>
-#include <unordered_map>
+#include <array>
 
 /**
- * This class is represents the "subject" of the observer pattern.
+ * This class is represents the "subject" of the observer pattern. Observers live in a fixed array,
+ * so notifying them is a plain loop of member function calls in registration order.
  *
  * @tparam T Observer Type
+ * @tparam Capacity Maximum number of observers registered at once
  */
-template <typename T>
+template <typename T, size_t Capacity = 4>
 class KPSubject {
 protected:
 	using ObserverType = T;
-	std::unordered_map<int, ObserverType *> observers;
+	std::array<ObserverType *, Capacity> observers{};
 
 public:
 	/**
-	 * Add the observer to the internal data structure
+	 * Add the observer to the first free slot
 	 *
 	 * @param o Pointer to the observer instance
-	 * @return int Randomly generated token (use to remove the observer later)
+	 * @return int Slot index (use to remove the observer later), -1 if all slots are taken
 	 */
 	int addObserver(ObserverType * o) {
-		auto token = rand();
-		while (!observers.insert({token, o}).second) {
-			token = rand();
+		for (size_t i = 0; i < Capacity; i++) {
+			if (!observers[i]) {
+				observers[i] = o;
+				return i;
+			}
 		}
 
-		return token;
+		return -1;
 	}
 
 	/**
@@ -45,16 +48,19 @@ public:
 	}
 
 	/**
-	 * Remove observer given a token
+	 * Remove observer given its slot index. Safe to call from inside a notification.
 	 *
-	 * @param token Token generated when calling addObserver methods
+	 * @param token Index returned by addObserver methods
 	 */
 	void removeObserver(int token) {
-		observers.erase(token);
+		if (token >= 0 && static_cast<size_t>(token) < Capacity) {
+			observers[token] = nullptr;
+		}
 	}
 
 	/**
-	 * Pass variable number of arguments to observers' class member function
+	 * Pass variable number of arguments to observers' class member function. The arguments are
+	 * passed as lvalues because every observer gets the same ones.
 	 *
 	 * @tparam F Auto deduced type of observer's member function
 	 * @tparam Types Auto deduced types of arguments
@@ -63,9 +69,10 @@ public:
 	 */
 	template <typename F, typename... Types>
 	void updateObservers(F method, Types &&... args) {
-		for (auto & k : observers) {
-			println("Updating ", k.second->ObserverName());
-			(k.second->*method)(std::forward<Types>(args)...);
+		for (auto o : observers) {
+			if (o) {
+				(o->*method)(args...);
+			}
 		}
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <Action.hpp>
+
+/**
+ * Stackless coroutine driven by the shared ActionScheduler. Subclasses write step() as straight
+ * line code between KP_TASK_BEGIN() and KP_TASK_END() and suspend with KP_TASK_YIELD() or
+ * KP_TASK_AWAIT(condition). The scheduler resumes the task at the point it left off on a later
+ * loop, so the rest of the application keeps running in between.
+ *
+ * Locals do not survive a suspension: keep loop counters and partial results as members. Use at
+ * most one suspension point per source line, and none inside a switch statement of its own.
+ */
+class KPTask {
+protected:
+	unsigned short resumePoint = 0;
+	bool running			   = false;
+	ActionHandle handle;
+
+	friend void startTask(KPTask & task, long pollInterval);
+	friend void stopTask(KPTask & task);
+
+public:
+	const char * name;
+
+	KPTask(const char * name) : name(name) {}
+	virtual ~KPTask() = default;
+
+	/**
+	 * Resume the task until its next suspension point
+	 *
+	 * @return true once the task has run to completion
+	 */
+	virtual bool step() = 0;
+
+	bool isRunning() const {
+		return running;
+	}
+};
+
+#define KP_TASK_BEGIN()                                                                            \
+	switch (resumePoint) {                                                                         \
+	case 0:
+
+#define KP_TASK_YIELD()                                                                            \
+	do {                                                                                           \
+		resumePoint = __LINE__;                                                                    \
+		return false;                                                                              \
+	case __LINE__:;                                                                                \
+	} while (0)
+
+#define KP_TASK_AWAIT(condition)                                                                   \
+	do {                                                                                           \
+		resumePoint = __LINE__;                                                                    \
+	case __LINE__:                                                                                 \
+		if (!(condition)) {                                                                        \
+			return false;                                                                          \
+		}                                                                                          \
+	} while (0)
+
+#define KP_TASK_END()                                                                              \
+	}                                                                                              \
+	resumePoint = 0;                                                                               \
+	return true
+
+/**
+ * Stop the task if it is running
+ */
+inline void stopTask(KPTask & task) {
+	cancel(task.handle);
+	task.running	 = false;
+	task.resumePoint = 0;
+}
+
+/**
+ * (Re)start the task from the beginning. It is stepped once per loop, or at most every
+ * pollInterval milliseconds, until step() reports completion.
+ *
+ * @param task Task instance; must outlive its run
+ * @param pollInterval Minimum time between two steps
+ */
+inline void startTask(KPTask & task, long pollInterval = 0) {
+	stopTask(task);
+	task.running = true;
+
+	TimedAction action;
+	action.name		 = task.name;
+	action.interval	 = pollInterval;
+	action.repeatFor = -1;
+	action.callback	 = [&task]() {
+		 if (task.step()) {
+			 stopTask(task);
+		 }
+	};
+
+	task.handle = run(std::move(action));
+}
@@ -155,6 +155,12 @@ void MS_5803::readSensor() {
 		D1 = MS_5803_ADC(CMD_ADC_D1 + CMD_ADC_4096);  // read raw pressure
 		D2 = MS_5803_ADC(CMD_ADC_D2 + CMD_ADC_4096);  // read raw temperature
 	}
+	compensate();
+}
+
+//------------------------------------------------------------------
+// Convert the raw D1 and D2 values to pressure and temperature
+void MS_5803::compensate() {
 	// Calculate 1st order temperature, dT is a long integer
 	// D2 is originally cast as an uint32_t, but can fit in a int32_t, so we'll
 	// cast both parts of the equation below as signed values so that we can
@@ -265,18 +271,72 @@ unsigned char MS_5803::MS_5803_CRC(unsigned int n_prom[]) {
 }
 
 //-----------------------------------------------------------------
-// Send commands and read the temperature and pressure from the sensor
-unsigned long MS_5803::MS_5803_ADC(char commandADC) {
-	// D1 and D2 will come back as 24-bit values, and so they must be stored in
-	// a long integer on 8-bit Arduinos.
-	long result = 0;
+// Non-blocking reads: the same two conversions as readSensor(), with the
+// wait for each left to the caller
+void MS_5803::startPressure() {
+	startADC(CMD_ADC_D1 + resolutionCommand());
+}
+
+void MS_5803::collectPressure() {
+	D1 = readADC();
+}
+
+void MS_5803::startTemperature() {
+	startADC(CMD_ADC_D2 + resolutionCommand());
+}
+
+void MS_5803::collectTemperature() {
+	D2 = readADC();
+	compensate();
+}
+
+// Longest conversion time at the current resolution, in ms. Matches the
+// delays in MS_5803_ADC().
+unsigned int MS_5803::conversionTime() const {
+	switch (resolutionCommand()) {
+	case CMD_ADC_256:
+		return 1;
+	case CMD_ADC_512:
+		return 3;
+	case CMD_ADC_1024:
+		return 4;
+	case CMD_ADC_2048:
+		return 6;
+	default:
+		return 10;
+	}
+}
+
+char MS_5803::resolutionCommand() const {
+	switch (_Resolution) {
+	case 256:
+		return CMD_ADC_256;
+	case 512:
+		return CMD_ADC_512;
+	case 1024:
+		return CMD_ADC_1024;
+	case 2048:
+		return CMD_ADC_2048;
+	default:
+		return CMD_ADC_4096;
+	}
+}
+
+//-----------------------------------------------------------------
+// Send the command to do the ADC conversion on the chip
+void MS_5803::startADC(char commandADC) {
 #ifdef I2CDEBUG
 	Serial.println("I2C Debug before beginTransmisson run");
 #endif
-	// Send the command to do the ADC conversion on the chip
 	Wire.beginTransmission(i2c_address);
 	Wire.write(CMD_ADC_CONV + commandADC);
 	Wire.endTransmission();
+}
+
+//-----------------------------------------------------------------
+// Send commands and read the temperature and pressure from the sensor
+unsigned long MS_5803::MS_5803_ADC(char commandADC) {
+	startADC(commandADC);
 	// Wait a specified period of time for the ADC conversion to happen
 	// See table on page 1 of the MS5803 data sheet showing response times of
 	// 0.5, 1.1, 2.1, 4.1, 8.22 ms for each accuracy level.
@@ -297,6 +357,15 @@ unsigned long MS_5803::MS_5803_ADC(char commandADC) {
 		delay(10);
 		break;
 	}
+	return readADC();
+}
+
+//-----------------------------------------------------------------
+// Read back the result of a finished conversion
+unsigned long MS_5803::readADC() {
+	// D1 and D2 will come back as 24-bit values, and so they must be stored in
+	// a long integer on 8-bit Arduinos.
+	long result = 0;
 	// Now send the read command to the MS5803
 
 	Wire.beginTransmission(i2c_address);
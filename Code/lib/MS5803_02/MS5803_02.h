@@ -42,6 +42,14 @@ public:
     void resetSensor();
     // Read the sensor
     void readSensor();
+    // Read the sensor without blocking: start a conversion, wait at least
+    // conversionTime() ms, then collect it. Pressure first, then temperature;
+    // collecting the temperature updates pressure() and temperature().
+    void startPressure();
+    void collectPressure();
+    void startTemperature();
+    void collectTemperature();
+    unsigned int conversionTime() const;
     //*********************************************************************
     // Additional methods to extract temperature, pressure (mbar), and the 
     // D1,D2 values after readSensor() has been called
@@ -83,6 +91,12 @@ private:
     unsigned char MS_5803_CRC(unsigned int n_prom[]); 
     // Handles commands to the sensor.
     unsigned long MS_5803_ADC(char commandADC);
+    void startADC(char commandADC);
+    unsigned long readADC();
+    // Compensate D1 and D2 into mbar and tempC
+    void compensate();
+    // CMD_ADC_* for the oversampling resolution
+    char resolutionCommand() const;
     // Oversampling resolution
     uint16_t _Resolution;
 };
@@ -2,6 +2,8 @@
 #include <KPController.hpp>
 #include <KPFileLoader.hpp>
 #include <KPStateMachine.hpp>
+#include <Action.hpp>
+#include <KPTask.hpp>
 
 #include <KPSerialInputObserver.hpp>
 #include <KPSerialInput.hpp>
@@ -15,20 +17,26 @@
 #include <Components/Pump.hpp>
 
 #include <Components/Button.hpp>
+#include <Components/PowerManager.hpp>
 
 #include <Components/Shell.hpp>
 
-#include <string>
-
 //#include <FileIO/Logger.hpp>
 
 #include <SD.h>
 #include <ArduinoJson.h>
+#include <StreamUtils.h>
 
+#include <Application/BootProfile.hpp>
 #include <Application/Clock.hpp>
+#include <Application/Log.hpp>
+#include <Application/Parameters.hpp>
+#include <FileIO/ConfigSlots.hpp>
+#include <FileIO/ConfigCache.hpp>
 #include <Components/LED.hpp>
 #include <Components/PressureSensor.hpp>
 #include <Components/LoadCell.hpp>
+#include <Components/Telemetry.hpp>
 
 class Application : public KPController, public KPSerialInputObserver {
 public:
@@ -48,27 +56,66 @@ public:
 	Shell shell{"shell", this};
 	LED led{"led", this};
 	PressureSensor pressure_sensor{"pressure-sensor", this};
-	StaticJsonDocument<512> doc;
+	ConfigSlots config{"state_a.bin", "state_b.bin"};
 	LoadCell load_cell{"load-cell", this};
+	PowerManager power{"power"};
+	Telemetry telemetry{"telemetry", this};
+	BootProfile boot;
+
+	// Initialisation that is not needed to answer the shell, finished after setup() returns
+	class DeferredSetup : public KPTask {
+	public:
+		Application & app;
+		unsigned long start;
+
+		DeferredSetup(Application & app) : KPTask("deferred-setup"), app(app) {}
+
+		bool step() override {
+			KP_TASK_BEGIN();
+			start = micros();
+			app.load_cell.beginReTare();
+			KP_TASK_AWAIT(!app.load_cell.isReading());
+			app.boot.record("load-cell tare", start);
+			LOG_INFO(LOAD, "Initial load;", app.load_cell.tare);
+			KP_TASK_END();
+		}
+	} deferredSetup{*this};
+
 	void setup() override {
-		Serial.begin(9600);
-		delay(3000);
+		boot.begin();
+		// No wait for the serial monitor: output queues in KPSerialOutput until the host reads it
+		Serial.begin(115200);
 		// Component setup
-		Serial.println("OK: Serial monitor online");
+		println("OK: Serial monitor online");
+		boot.mark("serial");
 		addComponent(sm);
 		addComponent(csm);
 		addComponent(pump);
 		addComponent(shift);
 		addComponent(KPSerialInput::sharedInstance());
+		addComponent(KPSerialOutput::sharedInstance());
+		addComponent(ActionScheduler::sharedInstance());
 		addComponent(shell);
 		//addComponent(logger);
 		addComponent(clock);
 		addComponent(led);
+		boot.mark("components");
 		addComponent(pressure_sensor);
+		boot.mark("pressure");
 		SD.begin(HardwarePins::SD);
+		boot.mark("sd");
 		addComponent(load_cell);
+		addComponent(power);
+		addComponent(telemetry);
+		power.addWakePin(HardwarePins::RUN_BUTTON);
+		power.addWakePin(HardwarePins::CLEAN_BUTTON);
+		power.addWakePin(HardwarePins::RTC_INT, Clock::onSecondEdge, FALLING);
 		KPSerialInput::sharedInstance().addObserver(this);
+		boot.mark("load-cell and power");
 		loadInfo();
+		boot.mark("settings");
+		boot.finish();
+		startTask(deferredSetup);
 	}
 
 	bool isBusy() {
@@ -83,144 +130,175 @@ public:
 			clean_button.listen();
 		}
 		KPController::update();
-#ifdef INFO_SPAM
-		// Note: this probably has severe impacts on performance.
-		// Only use in the case of a weird load/pressure bug.
-		print("Load 100: ");
-		load_cell.getLoadPrint(100);
-		println("; Pressure: ", pressure_sensor.getPressure());
-#endif
 	}
-	// Serial Monitor
-	void commandReceived(const char * line, size_t size) override {
-		std::string * args = new std::string[5];
-		char str[80];
-		strcpy(str, line);
-		println("Received: ", str);
-		const char delim[2] = " ";
-		const char * tok	= strtok(str, delim);
-		int i				= 0;
-		while (tok != NULL) {
-			args[i] = tok;
-			tok		= strtok(NULL, delim);
-			++i;
+	unsigned long idleTime() override {
+		unsigned long idle = KPController::idleTime();
+		if (!csm.isBusy()) {
+			idle = std::min(idle, run_button.idleTime());
+		}
+		if (!sm.isBusy()) {
+			idle = std::min(idle, clean_button.idleTime());
 		}
-		shell.runFunction(args, i);
+		return idle;
+	}
+
+	// Pump and valves are already off between cycles. The MS5803 only draws current during a
+	// conversion, so it needs no explicit power down.
+	void powerDown() {
+		load_cell.powerDown();
+		led.off();
+	}
+
+	void powerUp() {
+		load_cell.powerUp();
+		led.restore();
 	}
 
-	std::string readEntireFile(File & file) {
-		std::string contents;
-		while (-1 != file.peek()) {
-			contents.push_back(file.read());
+	// Sleep until the next deadline. Standby is only used between cycles, never while a
+	// procedure is driving the pump and valves. Long gaps that end on an RTC alarm power the
+	// peripherals down and hibernate until the alarm (or a button) wakes the MCU. Time slept is
+	// credited to uptimeMillis(), so the clock's epoch mapping stays valid without a resync.
+	void idle() {
+		bool allowStandby = !sm.isRunning() && !csm.isRunning();
+		auto ms			  = idleTime();
+		if (allowStandby && clock.alarmArmed && ms >= PowerSettings::HIBERNATE_THRESHOLD) {
+			KPSerialOutput::sharedInstance().flush();
+			powerDown();
+			power.hibernate(ms + PowerSettings::HIBERNATE_MARGIN);
+			powerUp();
+			return;
 		}
-		return contents;
+
+		power.sleep(ms, allowStandby);
+	}
+
+	// Serial Monitor
+	void commandReceived(const KPStringView * args, size_t count) override {
+		println("Received: ", args[0].c_str());
+		shell.runFunction(args, count);
 	}
+
+	void frameReceived(const uint8_t * payload, size_t size) override {
+		shell.runFrame(payload, size);
+	}
+
+	// Parse the newest valid config slot, or the state.js written before the slots existed,
+	// into doc. Streamed from the card through a small read buffer. Filtered, only the registered
+	// keys are kept, so neither the file nor its unknown entries are held in RAM.
+	bool readDocument(JsonDocument & doc, bool filtered = true) {
+		size_t length = 0;
+		File file	  = config.load(length);
+		if (!file) {
+			file = SD.open("state.js", FILE_READ);
+		}
+
+		if (!file) {
+			return false;
+		}
+
+		ReadBufferingStream buffered(file, 64);
+		DeserializationError error;
+		if (filtered) {
+			Parameters::Filter filter;
+			Parameters::filter(filter);
+			error = deserializeJson(doc, buffered, DeserializationOption::Filter(filter));
+		} else {
+			error = deserializeJson(doc, buffered);
+		}
+
+		file.close();
+		return !error;
+	}
+
+	// Settings from the flash cache while it matches the newest config slot, otherwise parsed
+	// from the card through the parameter registry and cached again
 	void loadInfo() {
-		if (SD.exists("state.js")) {
-			File file = SD.open("state.js", FILE_READ);
-			if (file) {
-				std::string contents = readEntireFile(file);
-				deserializeJson(doc, contents);
-				if (doc.containsKey("sample")) {
-					sm.getState<SampleStateFlush>(SampleStateNames::FLUSH).time
-						= doc["sample"]["flush_time"];
-					Serial.print("Flush time loaded from SD: ");
-					Serial.println(sm.getState<SampleStateFlush>(SampleStateNames::FLUSH).time);
-					sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).time
-						= doc["sample"]["sample_time"];
-					Serial.print("Sample time loaded from SD: ");
-					Serial.println(sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).time);	
-					sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).mass
-						= doc["sample"]["sample_mass"];
-					Serial.print("Sample mass loaded from SD: ");
-					Serial.println(sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).mass);
-					sm.getState<SampleStateIdle>(SampleStateNames::IDLE).time
-						= doc["sample"]["idle_time"];
-					Serial.print("Idle time loaded from SD: ");
-					Serial.println(sm.getState<SampleStateIdle>(SampleStateNames::IDLE).time);
-					sm.getState<SampleStateSetup>(SampleStateNames::SETUP).time
-						= doc["sample"]["setup_time"];
-					Serial.print("Setup time loaded from SD: ");
-					Serial.println(sm.getState<SampleStateSetup>(SampleStateNames::SETUP).time);
-					sm.last_cycle = doc["sample"]["last_cycle"];
-					Serial.print("Last sample cycle number loaded from SD: ");
-					Serial.println(sm.last_cycle);
-				}
-				if (doc.containsKey("clean")) {
-					csm.getState<CleanStateSample>(CleanStateNames::SAMPLE).time
-						= doc["clean"]["sample_time"];
-					Serial.print("Clean sample time loaded from SD: ");
-					Serial.println(csm.getState<CleanStateSample>(CleanStateNames::SAMPLE).time);
-					csm.getState<CleanStateIdle>(CleanStateNames::IDLE).time
-						= doc["clean"]["idle_time"];
-					Serial.print("Clean idle time loaded from SD: ");
-					Serial.println(csm.getState<CleanStateIdle>(CleanStateNames::IDLE).time);
-					csm.getState<CleanStateFlush>(CleanStateNames::FLUSH).time
-						= doc["clean"]["flush_time"];
-					Serial.print("Clean flush time loaded from SD: ");
-					Serial.println(csm.getState<CleanStateFlush>(CleanStateNames::FLUSH).time);	
-					csm.last_cycle = doc["clean"]["last_cycle"];
-					Serial.print("Last clean cycle number loaded from SD: ");
-					Serial.println(csm.last_cycle);
-				}
-
-				// this is an alternative way of doing containsKey
-				// which is more efficient when checking indiv objs
-				JsonVariant pressure = doc["pressure"]["max_pressure"];
-				if (!pressure.isNull()){
-					pressure_sensor.max_pressure = pressure;
-					Serial.print("Max pressure loaded from SD: ");
-					Serial.println(pressure_sensor.max_pressure);
-				}
-				pressure = doc["pressure"]["min_pressure"];
-				if (!pressure.isNull()){
-					pressure_sensor.min_pressure = pressure;
-					Serial.print("Min pressure loaded from SD: ");
-					Serial.println(pressure_sensor.min_pressure);
-				}
-				if (doc.containsKey("load_cell")) {
-					load_cell.factor = doc["load_cell"]["factor"];
-					load_cell.offset = doc["load_cell"]["offset"];
-					Serial.print("From SD card: Load cell factor ");
-					Serial.print(load_cell.factor,6);
-					Serial.print(" and offset ");
-					Serial.println(load_cell.offset,3);
-				}
+		bool onCard = config.scan();
+		if (onCard && ConfigCache::apply(*this, config.activeSeq(), config.activeCrc())) {
+			LOG_INFO(STORAGE, "Settings from flash cache");
+			return;
+		}
+
+		auto & doc = configDocument;
+		if (!readDocument(doc)) {
+			if (ConfigCache::apply(*this, 0, 0, true)) {
+				LOG_WARN(STORAGE, "No settings on the card, using the flash cache");
 			} else {
-				Serial.println("Error file read");
+				LOG_ERROR(STORAGE, "Error file read");
 			}
-			file.close();
-		} else {
-			// createStateFile();
-			Serial.println("Error file read");
-		}
-	}
-	// Future: more than two "levels" in loc, new value not int?
-	// Rewrites into the JSON and file
-	// Make it a template
-	void reWrite(const char ** loc, int & value, int new_value) {
-		value				= new_value;
-		doc[loc[0]][loc[1]] = value;
-		std::string contents;
-		serializeJson(doc, contents);
-		const char * contents_const = contents.c_str();
-		if (SD.exists("state.js"))
-			SD.remove("state.js");
-		File file = SD.open("state.js", FILE_WRITE);
-		file.write(contents_const);
-		file.close();
+			return;
+		}
+
+		Parameters::load(*this, doc);
+		if (onCard) {
+			ConfigCache::store(*this, config.activeSeq(), config.activeCrc());
+		}
 	}
 
-	void reWrite(const char ** loc, float & value, float new_value) {
-		value				= new_value;
-		doc[loc[0]][loc[1]] = value;
-		std::string contents;
-		serializeJson(doc, contents);
-		const char * contents_const = contents.c_str();
-		if (SD.exists("state.js"))
-			SD.remove("state.js");
-		File file = SD.open("state.js", FILE_WRITE);
-		file.write(contents_const);
-		file.close();
+	// Set a registered parameter field; the file is written on the next commit
+	template <typename T, typename V>
+	void reWrite(T & field, V value) {
+		field = value;
+		configChanged();
 	}
-};
\ No newline at end of file
+
+	// Restart the quiet period; a burst of changes is written once it has passed
+	void configChanged() {
+		configDirty = true;
+		cancel(configCommit);
+		configCommit = run(configTransaction ? ConfigSettings::TRANSACTION_TIMEOUT
+											 : ConfigSettings::QUIET_PERIOD,
+			[this]() { commitConfig(); });
+	}
+
+	// Hold changes in memory until commitConfig(); the quiet period then only backs up a host
+	// that never commits
+	void beginConfig() {
+		configTransaction = true;
+	}
+
+	// Save all changes since the last commit at once; nothing if there are none. A failed save
+	// stays dirty for the next commit.
+	void commitConfig() {
+		cancel(configCommit);
+		configTransaction = false;
+		if (!configDirty) {
+			return;
+		}
+
+		// Start from the stored file so entries the registry does not know are kept, as long as
+		// there is still room for every registered value
+		auto & doc = configDocument;
+		if (!readDocument(doc, false)) {
+			doc.clear();
+		} else if (doc.capacity() - doc.memoryUsage() < Parameters::DOCUMENT_CAPACITY) {
+			LOG_WARN(STORAGE, "No room to keep unknown settings entries");
+			doc.clear();
+		}
+
+		Parameters::save(*this, doc);
+		size_t size = measureJson(doc);
+		if (size > ConfigSlots::MAX_PAYLOAD) {
+			LOG_ERROR(STORAGE, "Settings do not fit a config slot");
+			return;
+		}
+
+		// Serialized straight into the slot file
+		if (config.save(size, [&doc](Print & out) { serializeJson(doc, out); })) {
+			configDirty = false;
+			ConfigCache::store(*this, config.activeSeq(), config.activeCrc());
+		}
+	}
+
+	bool isConfigDirty() const {
+		return configDirty;
+	}
+
+private:
+	bool configDirty	   = false;
+	bool configTransaction = false;
+	ActionHandle configCommit;
+	// Settings as parsed at boot and rewritten on commit; a member rather than on the stack of
+	// the scheduler callback that commits. Room for a whole slot, unknown entries included.
+	StaticJsonDocument<2 * ConfigSlots::SLOT_SIZE> configDocument;
+};
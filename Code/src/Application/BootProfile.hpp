@@ -0,0 +1,58 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <Application/Log.hpp>
+
+// Start and duration of each boot phase, in microseconds since setup() began. Phases inside
+// setup() are marked one after the other; initialisation deferred to a task records its own
+// phase once it completes.
+class BootProfile {
+public:
+	static constexpr size_t MAX_PHASES = 12;
+
+	struct Phase {
+		const char * name;
+		unsigned long start;
+		unsigned long duration;
+	};
+
+private:
+	Phase phases[MAX_PHASES];
+	size_t count		 = 0;
+	unsigned long origin = 0;
+	unsigned long last	 = 0;
+
+public:
+	void begin() {
+		count  = 0;
+		origin = last = micros();
+	}
+
+	// Record a phase that started at micros() == start and ended now
+	void record(const char * name, unsigned long start) {
+		auto now = micros();
+		if (count < MAX_PHASES) {
+			phases[count++] = {name, start - origin, now - start};
+		}
+
+		LOG_INFO(BOOT, name, " took ", (now - start) / 1000.0, " ms");
+	}
+
+	// Record the phase since the previous mark (or begin())
+	void mark(const char * name) {
+		auto start = last;
+		record(name, start);
+		last = micros();
+	}
+
+	// Record setup() as a whole
+	void finish() {
+		record("setup", origin);
+	}
+
+	void print() const {
+		for (size_t i = 0; i < count; i++) {
+			println(phases[i].name, ": at ", phases[i].start / 1000.0, " ms, took ",
+				phases[i].duration / 1000.0, " ms");
+		}
+	}
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <KPFoundation.hpp>
+#include <Action.hpp>
+#include <KPTask.hpp>
 #include <DS3232RTC.h>
 #include <Application/Constants.hpp>
 #include <Wire.h>
@@ -9,31 +11,344 @@
 
 #define RTC_ADDR 0x68
 
+/**
+ * Time service. uptime() is a 64-bit monotonic millisecond counter that keeps counting through
+ * standby. Wall time is mapped onto it from an anchor taken on a DS3232 second edge. While no
+ * alarm is armed the DS3232 drives a 1 Hz square wave on INT/SQW and onSecondEdge() latches
+ * millis() on every falling edge, which is when the seconds register ticks over. With an alarm
+ * armed the pin belongs to the alarm, and the anchor is re-taken every
+ * ClockSettings::SYNC_INTERVAL by polling the seconds register instead.
+ *
+ * The edges also measure how fast the MCU timebase runs against the DS3232 (driftPpm). Once the
+ * baseline is long enough the estimate rescales uptimeMillis(), so timed states follow the RTC.
+ * The DS3232 itself is checked against the host: every set() compares the RTC with the time it
+ * was last set to (kept in the DS3232's battery-backed SRAM), and trim() folds that drift into
+ * the DS3232 aging offset.
+ */
 class Clock : public KPComponent {
+private:
+	// Time it was last set to by the host, little endian, in the DS3232 SRAM
+	static constexpr uint8_t LAST_SET_ADDR = SRAM_START_ADDR;
+
+	struct SecondEdges {
+		volatile uint32_t millis = 0;
+		volatile uint32_t count	 = 0;
+	};
+
+	static SecondEdges & secondEdges() {
+		static SecondEdges edges;
+		return edges;
+	}
+
+	// Waits for the seconds register to tick over and anchors on the edge
+	class EdgeSync : public KPTask {
+	private:
+		Clock & clock;
+		time_t start	  = 0;
+		time_t seconds	  = 0;
+		uint64_t deadline = 0;
+
+	public:
+		EdgeSync(Clock & clock) : KPTask("clock-edge-sync"), clock(clock) {}
+
+		bool step() override {
+			KP_TASK_BEGIN();
+			start	 = clock.rtc.get();
+			deadline = uptimeMillis() + ClockSettings::EDGE_TIMEOUT;
+			KP_TASK_AWAIT((seconds = clock.rtc.get()) != start || uptimeMillis() > deadline);
+			if (seconds == start + 1) {
+				clock.anchorOnEdge(seconds);
+			}
+			KP_TASK_END();
+		}
+	} edgeSync{*this};
+
+	time_t epochAnchor	  = 0;
+	uint64_t uptimeAnchor = 0;
+	uint64_t stampMillis  = -1;
+	char stampBuffer[25];
+	const char * stamp = "";
+
+	bool squareWave	   = false;
+	bool edgeAnchored  = false;
+	uint32_t seenEdges = 0;
+
+	// Start of the drift baseline: RTC edge and raw (uncorrected) uptime at that edge
+	time_t driftEpoch = 0;
+	uint64_t driftRaw = 0;
+
+	// Anchor the epoch mapping on the edge that started `seconds`, sinceEdge milliseconds ago
+	void anchorOnEdge(time_t seconds, unsigned long sinceEdge = 0) {
+		auto raw	 = rawUptimeMillis() - sinceEdge;
+		epochAnchor	 = seconds;
+		uptimeAnchor = uptime() - sinceEdge;
+		setTime(seconds);
+
+		if (driftEpoch == 0 || seconds <= driftEpoch) {
+			driftEpoch	  = seconds;
+			driftRaw	  = raw;
+			driftBaseline = 0;
+			return;
+		}
+
+		driftBaseline	= seconds - driftEpoch;
+		double expected = driftBaseline * 1000.0;
+		driftPpm		= ((raw - driftRaw) - expected) / expected * 1e6;
+		if (correctTimebase && driftBaseline >= ClockSettings::DRIFT_MIN_BASELINE) {
+			setTimebaseCorrection(lround(driftPpm * 1000));
+		}
+	}
+
+	void restartDriftBaseline() {
+		driftEpoch	  = 0;
+		driftBaseline = 0;
+	}
+
+	time_t lastSet() {
+		uint8_t bytes[4];
+		rtc.readRTC(LAST_SET_ADDR, bytes, sizeof(bytes));
+		return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16
+			   | (uint32_t) bytes[3] << 24;
+	}
+
+	void setLastSet(time_t seconds) {
+		uint8_t bytes[4] = {uint8_t(seconds), uint8_t(seconds >> 8), uint8_t(seconds >> 16),
+			uint8_t(seconds >> 24)};
+		rtc.writeRTC(LAST_SET_ADDR, bytes, sizeof(bytes));
+	}
+
 public:
 	DS3232RTC rtc;
+	time_t alarmTime = 0;
+	bool alarmArmed	 = false;
+
+	// MCU timebase against the DS3232, positive when the MCU runs fast
+	float driftPpm		 = 0;
+	time_t driftBaseline = 0;
+	bool correctTimebase = true;
+
+	// DS3232 against the host between the last two set() calls, positive when the RTC runs fast
+	float rtcDriftPpm  = 0;
+	bool rtcDriftValid = false;
+
 	Clock(const char * name) : KPComponent(name), rtc(false) {}
 	void setup() {
 		//waitForConnection();
 		rtc.begin();
+		rtc.alarmInterrupt(ALARM_1, false);
+		rtc.alarmInterrupt(ALARM_2, false);
+		// INT/SQW is open drain; the falling edges are caught by onSecondEdge()
+		pinMode(HardwarePins::RTC_INT, INPUT_PULLUP);
+		sync();
+		enableSquareWave();
+		runForever(ClockSettings::SYNC_INTERVAL, "clock-sync", [this]() { resync(); });
+	}
+
+	// Re-read the seconds register on the next edge
+	void resync() {
+		if (squareWave) {
+			edgeAnchored = false;
+		} else {
+			startTask(edgeSync, ClockSettings::EDGE_POLL);
+		}
+	}
+
+	/**
+	 * Interrupt handler for the falling edge of INT/SQW. Attach it to HardwarePins::RTC_INT.
+	 */
+	static void onSecondEdge() {
+		auto & edges = secondEdges();
+		edges.millis = millis();
+		edges.count	 = edges.count + 1;
+	}
+
+	// Re-anchor on the latest square wave edge. The seconds register is only read for the first
+	// edge and once every SYNC_INTERVAL; in between the second is predicted from uptime.
+	void update() override {
+		if (!squareWave) {
+			return;
+		}
+
+		noInterrupts();
+		uint32_t count	 = secondEdges().count;
+		uint32_t latched = secondEdges().millis;
+		interrupts();
+		if (count == seenEdges) {
+			return;
+		}
+
+		seenEdges			= count;
+		unsigned long since = millis() - latched;
+		if (!edgeAnchored) {
+			// The read has to land in the same second as the edge
+			if (since < 500) {
+				anchorOnEdge(rtc.get(), since);
+				edgeAnchored = true;
+			}
+			return;
+		}
+
+		uint64_t edge = uptime() - since;
+		anchorOnEdge(epochAnchor + (edge - uptimeAnchor + 500) / 1000, since);
+	}
+
+	uint64_t uptime() const {
+		return uptimeMillis();
+	}
+
+	uint64_t epochMillis() const {
+		return (uint64_t) epochAnchor * 1000 + (uptime() - uptimeAnchor);
+	}
+
+	time_t epoch() const {
+		return epochMillis() / 1000;
+	}
+
+	/**
+	 * Current epoch time as seconds with a millisecond fraction ("1600000000.250"). Formatted at
+	 * most once per millisecond into an internal buffer.
+	 *
+	 * @return const char* Valid until the next call
+	 */
+	const char * timestamp() {
+		auto ms = epochMillis();
+		if (ms != stampMillis) {
+			stampMillis		= ms;
+			stamp			= formatUnsigned(stampBuffer + 21, ms / 1000);
+			auto frac		= ms % 1000;
+			stampBuffer[20] = '.';
+			stampBuffer[21] = '0' + frac / 100;
+			stampBuffer[22] = '0' + frac / 10 % 10;
+			stampBuffer[23] = '0' + frac % 10;
+			stampBuffer[24] = 0;
+		}
+
+		return stamp;
+	}
+
+	/**
+	 * Program alarm 1 to pull INT/SQW low at the given epoch time
+	 *
+	 * @param at Unix time of the alarm; must be within the next month
+	 */
+	void setAlarm(time_t at) {
+		tmElements_t tm;
+		breakTime(at, tm);
+		disableSquareWave();
+		rtc.setAlarm(ALM1_MATCH_DATE, tm.Second, tm.Minute, tm.Hour, tm.Day);
+		rtc.alarm(ALARM_1);	 // clear a stale flag so the pin is released
+		rtc.alarmInterrupt(ALARM_1, true);
+		alarmTime  = at;
+		alarmArmed = true;
+	}
+
+	void clearAlarm() {
+		rtc.alarmInterrupt(ALARM_1, false);
+		rtc.alarm(ALARM_1);
+		alarmArmed = false;
+		enableSquareWave();
+	}
+
+	// INT/SQW carries the 1 Hz square wave; alarms cannot signal on the pin meanwhile
+	void enableSquareWave() {
+		rtc.squareWave(SQWAVE_1_HZ);
+		seenEdges	 = secondEdges().count;
+		edgeAnchored = false;
+		squareWave	 = true;
+		stopTask(edgeSync);
+	}
+
+	// INT/SQW goes back to signalling alarms; anchors fall back to polling the seconds register
+	void disableSquareWave() {
 		rtc.squareWave(SQWAVE_NONE);
-		setTime(rtc.get());
+		squareWave = false;
 	}
-	void set(unsigned long long seconds) {
+
+	// Re-anchor the epoch mapping on the RTC right away, to within a second. TimeLib is kept in
+	// step for its calendar helpers.
+	void sync() {
+		epochAnchor	 = rtc.get();
+		uptimeAnchor = uptime();
+		setTime(epochAnchor);
+	}
+
+	/**
+	 * Set the RTC to the host's time. Measures the RTC drift since the previous set.
+	 *
+	 * @param seconds Unix time
+	 */
+	void set(time_t seconds) {
+		auto previous = lastSet();
+		auto elapsed  = seconds - previous;
+		if (previous != 0 && elapsed >= ClockSettings::TRIM_MIN_BASELINE) {
+			rtcDriftPpm	  = (double) (rtc.get() - seconds) / elapsed * 1e6;
+			rtcDriftValid = true;
+		}
+
 		rtc.set(seconds);
-		setTime(rtc.get());
+		setLastSet(seconds);
+		sync();
+		restartDriftBaseline();
+		resync();
+	}
+
+	int8_t aging() {
+		return (int8_t) rtc.readRTC(RTC_AGING);
+	}
+
+	void setAging(int8_t offset) {
+		rtc.writeRTC(RTC_AGING, (uint8_t) offset);
+		// The new offset takes effect on the next temperature conversion; start one now
+		rtc.writeRTC(RTC_CONTROL, rtc.readRTC(RTC_CONTROL) | _BV(CONV));
+		restartDriftBaseline();
+	}
+
+	/**
+	 * Fold the measured RTC drift into the aging offset. The drift has to be measured again
+	 * (two set() calls TRIM_MIN_BASELINE apart) before the next trim.
+	 *
+	 * @return bool false if there is no valid drift measurement
+	 */
+	bool trim() {
+		if (!rtcDriftValid) {
+			return false;
+		}
+
+		long offset = aging() + lround(rtcDriftPpm / ClockSettings::AGING_PPM_PER_LSB);
+		setAging(std::max(-128L, std::min(127L, offset)));
+		setLastSet(0);
+		rtcDriftValid = false;
+		return true;
+	}
+
+	// Turning the correction off drops it right away; turning it on waits for the next edge
+	void setCorrectTimebase(bool enable) {
+		correctTimebase = enable;
+		if (!enable) {
+			setTimebaseCorrection(0);
+		}
+	}
+
+	void printDrift() {
+		println("mcu ", driftPpm, " ppm over ", driftBaseline, " s, correction ",
+			timebaseCorrection().ppb, " ppb", correctTimebase ? "" : " (off)");
+		if (rtcDriftValid) {
+			println("rtc ", rtcDriftPpm, " ppm, aging ", aging());
+		} else {
+			println("rtc unmeasured, aging ", aging());
+		}
 	}
 
 	time_t cmpTime(time_t cmp) {
-		return cmp - now();
+		return cmp - epoch();
 	}
 
 	time_t cmpTime(const tmElements_t & cmp) {
-		return makeTime(cmp) - now();
+		return makeTime(cmp) - epoch();
 	}
 
 	time_t getTime() {
-		return now();
+		return epoch();
 	}
 
 	// don't need
@@ -42,9 +357,9 @@ public:
 		for (;; delay(5000)) {
 			Wire.requestFrom(RTC_ADDR, 1, false);
 			if (Wire.read() == -1) {
-				Serial.println("RTC not connected.");
+				println("RTC not connected.");
 			} else {
-				Serial.println("RTC connected");
+				println("RTC connected");
 				break;
 			}
 		}
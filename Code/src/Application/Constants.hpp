@@ -13,6 +13,7 @@ namespace HardwarePins {
 	constexpr int SCLK			 = 0;
 	constexpr int PDWN			 = 1;
 	constexpr int PIXEL		  	 = A4;
+	constexpr int RTC_INT		 = A1;
 }  // namespace HardwarePins
 
 namespace DefaultTimes {
@@ -33,6 +34,40 @@ namespace DefaultTimesButton {
 	const unsigned long DEBOUNCE_TIME = 100;
 }
 
+namespace ClockSettings {
+	// How often the epoch mapping is re-anchored on the DS3232
+	constexpr long SYNC_INTERVAL = 10 * 60 * 1000L;
+	// Polling period while waiting for the next RTC second edge; bounds the anchor error
+	constexpr long EDGE_POLL			 = 5;
+	constexpr unsigned long EDGE_TIMEOUT = 1500;
+	// Baseline (seconds) before the MCU drift estimate is applied to the timebase
+	constexpr long DRIFT_MIN_BASELINE = 60 * 60L;
+	// Baseline (seconds) between two set_time calls before the RTC drift is trusted for trimming
+	constexpr long TRIM_MIN_BASELINE = 7 * 24 * 60 * 60L;
+	// DS3232 aging offset sensitivity at 25 C; positive codes slow the oscillator
+	constexpr float AGING_PPM_PER_LSB = 0.1f;
+}  // namespace ClockSettings
+
+namespace ConfigSettings {
+	// Config changes are written to SD once no further change came in for this long
+	constexpr long QUIET_PERIOD = 5000;
+	// Open transactions that are neither committed nor added to for this long are committed
+	constexpr long TRANSACTION_TIMEOUT = 60000;
+}  // namespace ConfigSettings
+
+namespace PowerSettings {
+	// Shorter waits only idle the CPU between SysTick interrupts
+	constexpr unsigned long STANDBY_THRESHOLD = 20;
+	constexpr unsigned long WATCHDOG_TIMEOUT = 12000;
+	// Longest standby; keeps the watchdog fed
+	constexpr unsigned long MAX_STANDBY = 8000;
+	// Waits at least this long with an RTC alarm armed power the peripherals down and
+	// hibernate with the watchdog off until the DS3232 alarm fires
+	constexpr unsigned long HIBERNATE_THRESHOLD = 30000;
+	// Backup wake-up after the alarm in case it never arrives
+	constexpr unsigned long HIBERNATE_MARGIN = 2000;
+}  // namespace PowerSettings
+
 namespace TPICDevices {
 	constexpr int INTAKE_POS  = 0;
 	constexpr int INTAKE_NEG  = 1;
@@ -43,4 +78,25 @@ namespace TPICDevices {
 namespace DefaultPressures {
 	constexpr int MIN_PRESSURE = 400;	// 600
 	constexpr int MAX_PRESSURE = 1300;	// 990
-}  // namespace DefaultPressures
\ No newline at end of file
+}  // namespace DefaultPressures
+
+namespace SampleSettings {
+	// Interval between load rows in data.csv while sampling; an SD write on every evaluation of
+	// the stop criteria would bound how often they run
+	constexpr unsigned long LOAD_LOG_INTERVAL = 1000;
+	// Time into sampling, on top of the load filter's lag, at which sampler 2 takes its weight
+	// offset from the load rate and after which the sampling time is re-estimated. The old loop
+	// took one blocking reading per pass and got there on its 4th and 6th readings.
+	constexpr unsigned long OFFSET_DELAY = 600;
+	constexpr unsigned long RATE_DELAY	 = 900;
+}  // namespace SampleSettings
+
+namespace LoadCellSettings {
+	// Conversions the interrupt can queue between two passes of the loop: 3.2 s at 10 SPS
+	constexpr size_t SAMPLE_RING = 32;
+	// Spike rejection window of the load filter, in conversions; odd
+	constexpr size_t MEDIAN_WINDOW = 5;
+	// Span of the load filter's moving average, in conversions: 2.5 s at 10 SPS. The filtered
+	// load counts as settled once this many conversions went in.
+	constexpr uint32_t FILTER_SPAN = 25;
+}  // namespace LoadCellSettings
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <KPLog.hpp>
+
+// Compile-time ceilings; raise one for a debugging build, e.g. -D KP_LOG_MAX_LOAD=KP_LOG_TRACE
+#ifndef KP_LOG_MAX_SAMPLE
+	#define KP_LOG_MAX_SAMPLE KP_LOG_MAX
+#endif
+#ifndef KP_LOG_MAX_LOAD
+	#define KP_LOG_MAX_LOAD KP_LOG_MAX
+#endif
+#ifndef KP_LOG_MAX_PRESSURE
+	#define KP_LOG_MAX_PRESSURE KP_LOG_MAX
+#endif
+#ifndef KP_LOG_MAX_SHIFT
+	#define KP_LOG_MAX_SHIFT KP_LOG_MAX
+#endif
+#ifndef KP_LOG_MAX_STORAGE
+	#define KP_LOG_MAX_STORAGE KP_LOG_MAX
+#endif
+#ifndef KP_LOG_MAX_BOOT
+	#define KP_LOG_MAX_BOOT KP_LOG_MAX
+#endif
+
+namespace LogModule {
+	enum Id : uint8_t { SAMPLE, LOAD, PRESSURE, SHIFT, STORAGE, BOOT, COUNT };
+	constexpr const char * NAMES[] = {"sample", "load", "pressure", "shift", "storage", "boot"};
+	constexpr uint8_t CEILINGS[]   = {KP_LOG_MAX_SAMPLE, KP_LOG_MAX_LOAD, KP_LOG_MAX_PRESSURE,
+		KP_LOG_MAX_SHIFT, KP_LOG_MAX_STORAGE, KP_LOG_MAX_BOOT};
+	static_assert(COUNT <= KPLog::MAX_MODULES, "Too many log modules");
+}  // namespace LogModule
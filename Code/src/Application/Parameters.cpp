@@ -0,0 +1,214 @@
+#include <Application/Parameters.hpp>
+#include <Application/Application.hpp>
+#include <Application/Log.hpp>
+#include <KPCommandTable.hpp>
+#include <type_traits>
+
+namespace {
+	constexpr long MAX_SECONDS = 7 * 24 * 60 * 60L;
+	constexpr long MAX_GRAMS   = 100000;
+	constexpr long MAX_CYCLES  = 1000;
+	constexpr long MAX_MBAR	   = 14000;
+}  // namespace
+
+#define SAMPLE_STATE(type, name) app.sm.getState<type>(SampleStateNames::name)
+#define CLEAN_STATE(type, name)	 app.csm.getState<type>(CleanStateNames::name)
+
+// One line per setting: id, section, spec (key, type, bounds), field
+#define PARAMETERS(X)                                                                            \
+	X(sample_flush_time, "sample", intArg("flush_time", 0, MAX_SECONDS),                          \
+		SAMPLE_STATE(SampleStateFlush, FLUSH).time)                                                \
+	X(sample_fill_time, "sample", intArg("fill_time", 0, MAX_SECONDS),                            \
+		SAMPLE_STATE(SampleStateFillTube, FILL_TUBE).time)                                         \
+	X(sample_sample_time, "sample", intArg("sample_time", 0, MAX_SECONDS),                        \
+		SAMPLE_STATE(SampleStateSample, SAMPLE).time)                                              \
+	X(sample_sample_mass, "sample", intArg("sample_mass", 0, MAX_GRAMS),                          \
+		SAMPLE_STATE(SampleStateSample, SAMPLE).mass)                                              \
+	X(sample_idle_time, "sample", intArg("idle_time", 0, MAX_SECONDS),                            \
+		SAMPLE_STATE(SampleStateIdle, IDLE).time)                                                  \
+	X(sample_setup_time, "sample", intArg("setup_time", 0, MAX_SECONDS),                          \
+		SAMPLE_STATE(SampleStateSetup, SETUP).time)                                                \
+	X(sample_setup_tod_enabled, "sample", intArg("setup_tod_enabled", 0, 1),                      \
+		SAMPLE_STATE(SampleStateSetup, SETUP).tod_enabled)                                         \
+	X(sample_setup_tod, "sample", intArg("setup_tod", 0), SAMPLE_STATE(SampleStateSetup, SETUP).tod) \
+	X(sample_last_cycle, "sample", intArg("last_cycle", 0, MAX_CYCLES), app.sm.last_cycle)        \
+	X(clean_sample_time, "clean", intArg("sample_time", 0, MAX_SECONDS),                          \
+		CLEAN_STATE(CleanStateSample, SAMPLE).time)                                                \
+	X(clean_idle_time, "clean", intArg("idle_time", 0, MAX_SECONDS),                              \
+		CLEAN_STATE(CleanStateIdle, IDLE).time)                                                    \
+	X(clean_flush_time, "clean", intArg("flush_time", 0, MAX_SECONDS),                            \
+		CLEAN_STATE(CleanStateFlush, FLUSH).time)                                                  \
+	X(clean_last_cycle, "clean", intArg("last_cycle", 0, MAX_CYCLES), app.csm.last_cycle)         \
+	X(pressure_min, "pressure", intArg("min_pressure", 0, MAX_MBAR),                              \
+		app.pressure_sensor.min_pressure)                                                          \
+	X(pressure_max, "pressure", intArg("max_pressure", 0, MAX_MBAR),                              \
+		app.pressure_sensor.max_pressure)                                                          \
+	X(load_cell_factor, "load_cell", floatArg("factor"), app.load_cell.factor)                   \
+	X(load_cell_offset, "load_cell", floatArg("offset"), app.load_cell.offset)
+
+namespace Fields {
+	// Parameter reads integer settings as int and real settings as float
+#define FIELD(id, section, spec, field)                                                          \
+	void * id(Application & app) {                                                                 \
+		static_assert((spec.type == KPArgType::real) == std::is_same<decltype(field), float>::value, \
+			#id " field type does not match its spec");                                            \
+		static_assert(                                                                             \
+			(spec.type == KPArgType::real) || std::is_same<decltype(field), int>::value,           \
+			#id " field type does not match its spec");                                            \
+		return &(field);                                                                           \
+	}
+
+	PARAMETERS(FIELD)
+#undef FIELD
+}  // namespace Fields
+
+namespace {
+#define ENTRY(id, section, spec, field) {section, spec, Fields::id},
+	constexpr Parameter registry[] = {PARAMETERS(ENTRY)};
+#undef ENTRY
+
+	constexpr size_t COUNT = sizeof(registry) / sizeof(registry[0]);
+	static_assert(COUNT <= Parameters::MAX_PARAMETERS, "Too many parameters to pack");
+
+	constexpr bool sameText(const char * a, const char * b) {
+		return *a == *b && (*a == 0 || sameText(a + 1, b + 1));
+	}
+
+	// Each section's entries are listed together, so a new section starts where the name changes
+	constexpr size_t sections(size_t i = 0) {
+		return i == COUNT ? 0
+						  : (i == 0 || !sameText(registry[i].section, registry[i - 1].section))
+								+ sections(i + 1);
+	}
+
+	static_assert(sections() <= Parameters::MAX_SECTIONS, "Too many sections for the filter");
+	static_assert(sizeof(int) == 4 && sizeof(float) == 4, "Packed values are 4 bytes");
+
+	bool matches(const Parameter & parameter, const char * section, size_t size, const char * key) {
+		return strncmp(parameter.section, section, size) == 0 && parameter.section[size] == 0
+			   && strcmp(parameter.spec.name, key) == 0;
+	}
+
+	const Parameter * find(const char * section, size_t size, const char * key) {
+		for (auto & parameter : registry) {
+			if (matches(parameter, section, size, key)) {
+				return &parameter;
+			}
+		}
+
+		return nullptr;
+	}
+}  // namespace
+
+namespace Parameters {
+	const Parameter * begin() {
+		return registry;
+	}
+
+	const Parameter * end() {
+		return registry + COUNT;
+	}
+
+	const Parameter * find(const char * path) {
+		auto dot = strchr(path, '.');
+		return dot ? ::find(path, dot - path, dot + 1) : nullptr;
+	}
+
+	void filter(Filter & filter) {
+		for (auto & parameter : registry) {
+			filter[parameter.section][parameter.spec.name] = true;
+		}
+	}
+
+	// One pass over the document; each entry is matched against the registry
+	void load(Application & app, JsonDocument & doc) {
+		for (JsonPair section : doc.as<JsonObject>()) {
+			auto name = section.key().c_str();
+			for (JsonPair entry : section.value().as<JsonObject>()) {
+				auto parameter = ::find(name, strlen(name), entry.key().c_str());
+				if (!parameter) {
+					continue;
+				}
+
+				auto & spec = parameter->spec;
+				if (spec.type == KPArgType::real) {
+					parameter->real(app) = entry.value().as<float>();
+				} else {
+					long value = entry.value().as<long>();
+					if (value < spec.min || value > spec.max) {
+						LOG_WARN(STORAGE, name, ".", spec.name, " out of range: ", value);
+						continue;
+					}
+
+					parameter->integer(app) = value;
+				}
+
+				LOG_INFO(STORAGE, "Loaded ", name, ".", spec.name);
+			}
+		}
+	}
+
+	void save(Application & app, JsonDocument & doc) {
+		for (auto & parameter : registry) {
+			auto section = parameter.section;
+			auto key	 = parameter.spec.name;
+			if (parameter.spec.type == KPArgType::real) {
+				doc[section][key] = parameter.real(app);
+			} else {
+				doc[section][key] = parameter.integer(app);
+			}
+		}
+	}
+
+	KPArgError set(Application & app, const Parameter & parameter, const KPStringView & token) {
+		KPArgValue value;
+		auto error = KPArgParser::parse(parameter.spec, token, value);
+		if (error != KPArgError::none) {
+			return error;
+		}
+
+		if (parameter.spec.type == KPArgType::real) {
+			parameter.real(app) = value.real;
+		} else {
+			parameter.integer(app) = value.integer;
+		}
+
+		return KPArgError::none;
+	}
+
+	uint32_t layout() {
+		uint32_t hash = 2166136261u;
+		for (auto & parameter : registry) {
+			hash = KPPerfectHash::fnv1a(parameter.section, hash);
+			hash = KPPerfectHash::fnv1a(parameter.spec.name, hash);
+			hash = (hash ^ static_cast<uint8_t>(parameter.spec.type)) * 16777619u;
+		}
+
+		return hash;
+	}
+
+	size_t pack(Application & app, uint32_t * values) {
+		size_t i = 0;
+		for (auto & parameter : registry) {
+			memcpy(values + i++, parameter.field(app), 4);
+		}
+
+		return i;
+	}
+
+	void unpack(Application & app, const uint32_t * values) {
+		size_t i = 0;
+		for (auto & parameter : registry) {
+			memcpy(parameter.field(app), values + i++, 4);
+		}
+	}
+
+	void print(Application & app, const Parameter & parameter) {
+		::print(parameter.section, ".", parameter.spec.name, " = ");
+		if (parameter.spec.type == KPArgType::real) {
+			KPSerialOutput::sharedInstance().println(parameter.real(app), 6);
+		} else {
+			println(parameter.integer(app));
+		}
+	}
+}  // namespace Parameters
@@ -0,0 +1,70 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <KPArgs.hpp>
+#include <ArduinoJson.h>
+
+class Application;
+
+// A persistent setting: its place in state.js, its type and bounds, and the field it lives in
+struct Parameter {
+	const char * section;
+	KPArgSpec spec;	 // spec.name is the key within the section
+	void * (*field)(Application & app);
+
+	int & integer(Application & app) const {
+		return *static_cast<int *>(field(app));
+	}
+
+	float & real(Application & app) const {
+		return *static_cast<float *>(field(app));
+	}
+};
+
+/**
+ * Registry of every persistent setting, in flash. Loading, saving, the shell's get/set and the
+ * dump all go through it, so a new setting is one line in Parameters.cpp.
+ */
+namespace Parameters {
+	// Room reserved for packed parameter sets, such as the flash cache
+	constexpr size_t MAX_PARAMETERS = 32;
+	// Sections the registry may use; bounds the filter document
+	constexpr size_t MAX_SECTIONS = 8;
+
+	// Room the registered values and their keys take in a parsed JSON document
+	constexpr size_t DOCUMENT_CAPACITY = 768;
+	// Deserialization filter that lets only the registered sections and keys through
+	using Filter = StaticJsonDocument<JSON_OBJECT_SIZE(MAX_PARAMETERS + MAX_SECTIONS)>;
+
+	const Parameter * begin();
+	const Parameter * end();
+
+	// By "section.key" path, nullptr if unknown
+	const Parameter * find(const char * path);
+
+	// Mark every registered section and key in the filter
+	void filter(Filter & filter);
+
+	// Apply every registered value found in the document; unknown or invalid entries are skipped
+	void load(Application & app, JsonDocument & doc);
+
+	// Write every registered value into the document, keeping entries it does not know
+	void save(Application & app, JsonDocument & doc);
+
+	/**
+	 * Check a value against the parameter's bounds and store it in the field
+	 *
+	 * @param token Value as text, e.g. from the shell
+	 * @return KPArgError none if the value was stored
+	 */
+	KPArgError set(Application & app, const Parameter & parameter, const KPStringView & token);
+
+	// Hash of every section, key and type; changes whenever the registry does
+	uint32_t layout();
+
+	// Every value as 4 raw bytes, in registry order
+	size_t pack(Application & app, uint32_t * values);
+	void unpack(Application & app, const uint32_t * values);
+
+	// "section.key = value"
+	void print(Application & app, const Parameter & parameter);
+}  // namespace Parameters
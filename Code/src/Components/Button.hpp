@@ -19,6 +19,11 @@ public:
 	void setup() {}
 	void update() {}
 
+	// Keep polling while a press or release is being debounced
+	unsigned long idleTime() override {
+		return digitalRead(pin) == buttonState ? IDLE_FOREVER : 0;
+	}
+
 	void act(StateMachine & sm);
 	void listen() {
 		int reading = digitalRead(pin);
@@ -19,6 +19,13 @@ namespace LEDNames {
 	constexpr const char * IDLE	   = "idle";
 	constexpr const char * RUN	   = "run";
 	constexpr const char * BATTERY = "battery";
+
+	// Names arrive from the shell as well, so compare them by content
+	struct less {
+		bool operator()(const char * a, const char * b) const {
+			return strcmp(a, b) < 0;
+		}
+	};
 };	// namespace LEDNames
 
 class LED : public KPComponent {
@@ -29,7 +36,7 @@ public:
 	Adafruit_NeoPixel pixel;
 	const unsigned short no_levels		 = 3;
 	std::array<Light *, 3> lights_active = {nullptr, nullptr, nullptr};
-	std::map<const char *, Light> lights;
+	std::map<const char *, Light, LEDNames::less> lights;
 	LED(const char * name, KPController * controller)
 		: KPComponent(name, controller), pixel(1, HardwarePins::PIXEL, NEO_RGB + NEO_KHZ800) {}
 	void setup() {
@@ -74,6 +81,16 @@ public:
 		lights_active.at(1) = nullptr;
 	}
 
+	// Blank the pixel without forgetting the colour; restore() brings it back
+	void off() {
+		pixel.clear();
+		pixel.show();
+	}
+
+	void restore() {
+		setColor(r, g, b);
+	}
+
 	void setRun() {
 		setColor(0, 30, 0);
 	}
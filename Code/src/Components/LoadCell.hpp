@@ -1,28 +1,98 @@
 #pragma once
 #include <KPFoundation.hpp>
+#include <KPTask.hpp>
+#include <KPRing.hpp>
+#include <KPFilter.hpp>
 #include <ADS1232.h>
 //#include <FileIO/SerialSD.hpp>
 #include <time.h>
 #include <Application/Constants.hpp>
+#include <Application/Log.hpp>
 #include <FileIO/CSVWriter.hpp>
-#include <String>
-#include <sstream>
 
 #define _dout HardwarePins::DOUT
 #define _sclk HardwarePins::SCLK
 #define _pdwn HardwarePins::PDWN
 
+class LoadCell;
+
+// One conversion, as clocked out by the DOUT interrupt
+struct LoadSample {
+	uint32_t time;	// millis() when it was clocked out
+	long counts;
+};
+
+// Waits in the background until the load filter has settled, then takes its value
+class LoadCellReadTask : public KPTask {
+public:
+	LoadCell & cell;
+	bool tare  = false;
+	float load = 0;
+
+	LoadCellReadTask(LoadCell & cell) : KPTask("load-cell-read"), cell(cell) {}
+	bool step() override;
+};
+
+/**
+ * ADS1232 load cell. Conversions are acquired by a DOUT falling-edge interrupt into a lock-free
+ * ring, so none is missed and no reader busy-waits for the converter. Every conversion then goes
+ * through a streaming filter (median spike rejection, then an exponential moving average), and
+ * readers take the filtered load and its variance as they stand instead of sampling again.
+ *
+ * The converter runs at 10 SPS: its SPEED pin is tied to ground on the current ADC board.
+ * setSpeed() keeps the sample state's request for 80 SPS in place for a board that routes it.
+ */
 class LoadCell : public KPComponent {
+private:
+	// Shared with the DOUT interrupt
+	struct Acquisition {
+		ADS1232 * adc = nullptr;
+		KPRing<LoadSample, LoadCellSettings::SAMPLE_RING> samples;
+		volatile long latest = 0;
+	};
+
+	static Acquisition & acquisition() {
+		static Acquisition acquisition;
+		return acquisition;
+	}
+
+	// DOUT falls once a conversion is ready. Clocking it out toggles DOUT as well, and the edges
+	// that latches call this again right away; read_if_ready() turns those calls away because
+	// the 25th clock leaves DOUT high.
+	static void onDataReady() {
+		auto & acquisition = LoadCell::acquisition();
+		long value;
+		if (!acquisition.adc || !acquisition.adc->read_if_ready(value)) {
+			return;
+		}
+
+		acquisition.latest = value;
+		acquisition.samples.push({millis(), value});
+	}
+
+	void startAcquisition() {
+		acquisition().adc = &weight;
+		attachInterrupt(digitalPinToInterrupt(_dout), onDataReady, FALLING);
+	}
+
+	void stopAcquisition() {
+		detachInterrupt(digitalPinToInterrupt(_dout));
+	}
+
 public:
 	CSVWriter csvw{"data.csv"};
-	ADS1232 weight = ADS1232(_pdwn, _sclk, _dout);
+	ADS1232 weight = ADS1232(_pdwn, _sclk, _dout, ADS1232::NO_PIN);
+	ADS1232::Speed speed = ADS1232::SPEED_10SPS;
 	float tare;
 	float factor = 0.002348;//0.002324227;
 
 	float offset = -19857.150;//-19691.0843;
 	long reading = 0;
-	long sum;
-	short count;
+	// Conversions filtered since boot
+	uint32_t conversions = 0;
+	KPFilterChain<KPMedianFilter<LoadCellSettings::MEDIAN_WINDOW>, KPEmaFilter> filter{
+		{}, KPEmaFilter(LoadCellSettings::FILTER_SPAN)};
+	LoadCellReadTask readTask{*this};
 
 	LoadCell(const char * name, KPController * controller)
 		: KPComponent(name, controller) {}
@@ -32,77 +102,137 @@ public:
   		weight.OFFSET = 0;
   		weight.SCALE = 1.0;
 		tare = 0;
+		startAcquisition();
+	}
+
+	// Run every conversion the interrupt queued through the filter
+	void update() override {
+		LoadSample sample;
+		while (acquisition().samples.pop(sample)) {
+			reading = sample.counts;
+			filter.add(reading);
+			conversions++;
+			LOG_TRACE(LOAD, "Load reading;", sample.time, ";", reading);
+		}
+	}
+
+	// The filter starts over after a power down; the load is stale by then
+	void powerDown() {
+		stopAcquisition();
+		weight.power_down();
+	}
+
+	void powerUp() {
+		weight.power_up();
+		acquisition().samples.clear();
+		filter.reset();
+		startAcquisition();
+	}
 
-		print("Initial load;");
-		println(reTare(50));
-	}
-	long read(int qty) {
-		//println("in read");
-
-		println();
-		sum = 0;
-		count = 0;
-		//display every reading
-		for (int i = 0; i < qty; ++i) {
-			reading = weight.raw_read(1);
-			#ifdef LOAD_CAL
-				print("Load reading;");
-				print(i);
-				print(";");
-				println(reading);
-			#endif
-				if (qty>4){
-					//don't include first 5 readings in average due to unreliability
-					if (i>3){
-						sum += reading;
-						count ++;
-						//print("tally of readings to average: ");
-						//println(count);
-					}
-				}
-				//if there aren't more than 5 readings, just use all of them
-				else {
-					sum += reading;
-					count ++;
-				}
-			}
-			reading = sum/(count);
-
-		return reading;
-	}
-
-	float getLoad(int qty) {
+	// Change the data rate. Does nothing while the SPEED pin is not routed to the board, which
+	// is the case for the current ADC board.
+	void setSpeed(ADS1232::Speed speed) {
+		if (weight.SPEED == ADS1232::NO_PIN || speed == this->speed) {
+			return;
+		}
+
+		// Drop anything converted at the old rate and start the filter over at the new one
+		weight.set_speed(speed);
+		acquisition().samples.clear();
+		filter.reset();
+		this->speed = speed;
+		LOG_DEBUG(LOAD, "Speed;", speed == ADS1232::SPEED_80SPS ? 80 : 10, " SPS");
+	}
+
+	// Enough conversions since the filter started over for the filtered load to be trusted
+	bool isSettled() const {
+		return filter.second.count() >= LoadCellSettings::FILTER_SPAN;
+	}
+
+	// Time between conversions at the current data rate, in ms
+	float conversionPeriod() const {
+		return speed == ADS1232::SPEED_80SPS ? 12.5 : 100;
+	}
+
+	// How far the filtered load trails a steadily changing load, in ms: half the median window
+	// plus the moving average's (span - 1) / 2 conversions
+	float filterLag() const {
+		return conversionPeriod()
+			   * (LoadCellSettings::MEDIAN_WINDOW / 2 + (LoadCellSettings::FILTER_SPAN - 1) / 2.0);
+	}
+
+	float toLoad(float counts) const {
+		return factor * counts + offset;
+	}
+
+	/**
+	 * Take the filtered load in the background. The filter starts over, so the result only
+	 * reflects conversions taken after the request; the read completes once FILTER_SPAN of them
+	 * went in, 2.5 s at 10 SPS. Poll isReading() and pick up the result from readTask.load (or
+	 * tare when taring) once it is done.
+	 *
+	 * @param retare Store the result as the new tare
+	 */
+	void beginRead(bool retare = false) {
+		filter.reset();
+		readTask.tare = retare;
+		startTask(readTask);
+	}
+
+	void beginReTare() {
+		beginRead(true);
+	}
+
+	bool isReading() const {
+		return readTask.isRunning();
+	}
+
+	// Filtered load in grams
+	float getLoad() const {
 		// gets factor and offset from this file during setup, gets factor and offset from SD after
-		//println("in getLoad");
-		return factor * read(qty) + offset;
+		return toLoad(filter.value());
 	}
 
-	float getLoadPrint(int qty) {
-		float load = getLoad(qty);
-		char load_string[50];
-		sprintf(load_string, "%d.%02u", (int)load, (int)((load - (int)load) * 100));
-		std::string strings[2] = {"FLAGGED LOAD, ", load_string};
-		csvw.writeStrings(strings, 2);
-		println("FLAGGED LOAD;", load_string);
+	// Load after spike rejection only, in grams. Noisier than getLoad(), but it trails the scale
+	// by half the median window rather than filterLag(), so stop decisions use it
+	float getFastLoad() const {
+		return toLoad(filter.first.value());
+	}
+
+	// Variance of the despiked conversions, in grams squared
+	float loadVariance() const {
+		return factor * factor * filter.second.variance();
+	}
+
+	float getLoadPrint() {
+		float load = getLoad();
+		csvw.writeLine("FLAGGED LOAD, ", load);
+		println("FLAGGED LOAD;", load);
 		return load;
 	}
 
-	float reTare(int qty) {
-		//println("in reTare");
-		tare = getLoad(qty);
+	float reTare() {
+		tare = getLoad();
 		return tare;
 	}
 
-	float getTaredLoad(int qty) {
-		return getLoad(qty) - tare;
+	float getTaredLoad() const {
+		return getLoad() - tare;
 	}
 
-	long getVoltage() {
-		return weight.raw_read(1);
+	// Latest conversion, unfiltered
+	long getVoltage() const {
+		return acquisition().latest;
 	}
+};
 
-	float readGrams() {
-		//println("in readGrams");
-		return factor * (long)weight.raw_read(1) + offset;
+inline bool LoadCellReadTask::step() {
+	KP_TASK_BEGIN();
+	KP_TASK_AWAIT(cell.isSettled());
+	load = cell.getLoad();
+	if (tare) {
+		cell.tare = load;
 	}
-};
\ No newline at end of file
+
+	KP_TASK_END();
+}
@@ -0,0 +1,125 @@
+#include <Components/PowerManager.hpp>
+#include <LowPower.h>
+#ifdef WATCHDOG
+	#include <Adafruit_SleepyDog.h>
+#endif
+
+namespace {
+	// GCLK4 feeds the RTC (and the EIC during standby) from the 32 kHz oscillator at 1024 Hz
+	constexpr unsigned long TICKS_PER_SECOND = 1024;
+
+	void waitForGCLK() {
+		while (GCLK->STATUS.bit.SYNCBUSY) {}
+	}
+
+	void waitForRTC() {
+		while (RTC->MODE0.STATUS.bit.SYNCBUSY) {}
+	}
+
+	void clockEIC(uint32_t generator) {
+		GCLK->CLKCTRL.reg = GCLK_CLKCTRL_ID(GCM_EIC) | generator | GCLK_CLKCTRL_CLKEN;
+		waitForGCLK();
+	}
+
+	uint32_t rtcCount() {
+		RTC->MODE0.READREQ.reg = RTC_READREQ_RREQ;
+		waitForRTC();
+		return RTC->MODE0.COUNT.reg;
+	}
+}  // namespace
+
+// Wake-up only; clearing the flag is all there is to do
+void RTC_Handler(void) {
+	RTC->MODE0.INTFLAG.reg = RTC_MODE0_INTFLAG_CMP0;
+}
+
+void PowerManager::setup() {
+#ifdef CRYSTALLESS
+	constexpr uint32_t source = GCLK_GENCTRL_SRC_OSCULP32K;
+#else
+	SYSCTRL->XOSC32K.bit.RUNSTDBY = 1;
+	constexpr uint32_t source = GCLK_GENCTRL_SRC_XOSC32K;
+#endif
+	// 32768 Hz / 2^(4 + 1) = 1024 Hz
+	GCLK->GENDIV.reg = GCLK_GENDIV_ID(4) | GCLK_GENDIV_DIV(4);
+	waitForGCLK();
+	GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(4) | source | GCLK_GENCTRL_GENEN | GCLK_GENCTRL_DIVSEL
+						| GCLK_GENCTRL_RUNSTDBY;
+	waitForGCLK();
+	GCLK->CLKCTRL.reg = GCLK_CLKCTRL_ID(GCM_RTC) | GCLK_CLKCTRL_GEN_GCLK4 | GCLK_CLKCTRL_CLKEN;
+	waitForGCLK();
+
+	PM->APBAMASK.reg |= PM_APBAMASK_RTC;
+	RTC->MODE0.CTRL.reg = RTC_MODE0_CTRL_SWRST;
+	while (RTC->MODE0.CTRL.bit.SWRST) {}
+	RTC->MODE0.CTRL.reg = RTC_MODE0_CTRL_MODE_COUNT32 | RTC_MODE0_CTRL_PRESCALER_DIV1;
+	waitForRTC();
+	RTC->MODE0.INTENSET.reg = RTC_MODE0_INTENSET_CMP0;
+	NVIC_EnableIRQ(RTC_IRQn);
+	RTC->MODE0.CTRL.reg |= RTC_MODE0_CTRL_ENABLE;
+	waitForRTC();
+
+	// Errata 13140: keep the NVM powered in sleep or the wake-up can hard fault
+	NVMCTRL->CTRLB.bit.SLEEPPRM = NVMCTRL_CTRLB_SLEEPPRM_DISABLED_Val;
+}
+
+void PowerManager::addWakePin(int pin, voidFuncPtr isr, uint32_t mode) {
+	if (!isr) {
+		isr = [] {};
+	}
+
+	auto interrupt = g_APinDescription[pin].ulExtInt;
+	attachInterrupt(digitalPinToInterrupt(pin), isr, mode);
+	EIC->WAKEUP.reg |= (1 << interrupt);
+}
+
+unsigned long PowerManager::sleep(unsigned long ms, bool allowStandby) {
+	if (ms == 0) {
+		return 0;
+	}
+
+	// USB is suspended in standby, which drops the serial connection to the host
+	if (!allowStandby || ms < standbyThreshold || USBDevice.configured()) {
+		LowPower.idle(IDLE_0);
+		return 0;
+	}
+
+	return standby(std::min(ms, maxStandby));
+}
+
+unsigned long PowerManager::hibernate(unsigned long ms) {
+	if (USBDevice.configured()) {
+		LowPower.idle(IDLE_0);
+		return 0;
+	}
+
+#ifdef WATCHDOG
+	Watchdog.disable();
+#endif
+	auto slept = standby(ms);
+#ifdef WATCHDOG
+	Watchdog.enable(PowerSettings::WATCHDOG_TIMEOUT);
+#endif
+	return slept;
+}
+
+unsigned long PowerManager::standby(unsigned long ms) {
+	auto start = rtcCount();
+	RTC->MODE0.COMP[0].reg = start + (uint64_t) ms * TICKS_PER_SECOND / 1000;
+	waitForRTC();
+	RTC->MODE0.INTFLAG.reg = RTC_MODE0_INTFLAG_CMP0;
+
+#ifdef WATCHDOG
+	Watchdog.reset();
+#endif
+	// Edge detection needs a clock that keeps running in standby
+	clockEIC(GCLK_CLKCTRL_GEN_GCLK4);
+	SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+	LowPower.standby();
+	SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+	clockEIC(GCLK_CLKCTRL_GEN_GCLK0);
+
+	unsigned long slept = (uint64_t)(rtcCount() - start) * 1000 / TICKS_PER_SECOND;
+	sleptMillis() += slept;
+	return slept;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <Application/Constants.hpp>
+
+/**
+ * Puts the SAMD21 to sleep between deadlines. Short waits idle the CPU until the next interrupt
+ * (SysTick wakes it every millisecond, so millis() keeps counting). Long waits enter standby with
+ * the MCU's own RTC as wake-up timer. The RTC keeps counting in standby, so the time actually
+ * slept is credited to uptimeMillis() even when a button press wakes the MCU early.
+ */
+class PowerManager : public KPComponent {
+public:
+	unsigned long standbyThreshold = PowerSettings::STANDBY_THRESHOLD;
+	unsigned long maxStandby	   = PowerSettings::MAX_STANDBY;
+
+	using KPComponent::KPComponent;
+
+	void setup() override;
+
+	/**
+	 * Allow an external interrupt on this pin to end standby early
+	 *
+	 * @param pin Arduino pin number
+	 * @param isr Handler to run on the interrupt, if the pin needs one besides waking the MCU
+	 * @param mode Edge to trigger on
+	 */
+	void addWakePin(int pin, voidFuncPtr isr = nullptr, uint32_t mode = CHANGE);
+
+	/**
+	 * Sleep for at most ms milliseconds
+	 *
+	 * @param ms Time until the next deadline
+	 * @param allowStandby false to only idle the CPU (e.g. while PWM outputs have to keep running)
+	 * @return unsigned long Milliseconds spent in standby (0 if the CPU only idled)
+	 */
+	unsigned long sleep(unsigned long ms, bool allowStandby = true);
+
+	/**
+	 * Standby with the watchdog disabled until a wake pin fires or ms milliseconds pass. Meant
+	 * for long gaps where an external alarm (the DS3232) ends the sleep.
+	 *
+	 * @param ms Backup wake-up time
+	 * @return unsigned long Milliseconds spent in standby
+	 */
+	unsigned long hibernate(unsigned long ms);
+
+private:
+	unsigned long standby(unsigned long ms);
+};
@@ -1,7 +1,9 @@
 #pragma once
 #include <MS5803_02.h>
 #include <KPFoundation.hpp>
+#include <KPTask.hpp>
 #include <application/Constants.hpp>
+#include <Application/Log.hpp>
 #include <Wire.h>
 #define PRESSURE_ADDR 0x77
 
@@ -11,10 +13,23 @@ inline bool checkForConnection(unsigned char addr) {
 	return Wire.read() != -1;
 }
 
+class PressureSensor;
+
+// Runs one pressure and temperature reading in the background, one conversion per step
+class PressureReadTask : public KPTask {
+public:
+	PressureSensor & owner;
+	unsigned long started = 0;
+
+	PressureReadTask(PressureSensor & owner) : KPTask("pressure-read"), owner(owner) {}
+	bool step() override;
+};
+
 class PressureSensor : public KPComponent {
 public:
 	bool connected;
 	MS_5803 sensor;
+	PressureReadTask readTask{*this};
 	int min_pressure			  = DefaultPressures::MIN_PRESSURE;
 	int max_pressure			  = DefaultPressures::MAX_PRESSURE;
 
@@ -22,25 +37,51 @@ public:
 		: KPComponent(name, controller), sensor(PRESSURE_ADDR) {}
 
 	void setup() override {
-		if (sensor.initializeMS_5803()) {
-			Serial.println("OK: MS5803 pressure sensor online");
+		// Not verbose: the PROM dump costs a 10 ms delay per coefficient
+		if (sensor.initializeMS_5803(false)) {
+			LOG_INFO(PRESSURE, "MS5803 pressure sensor online");
 		} else {
-			Serial.println("ERR: MS5803 pressure sensor offline");
+			LOG_ERROR(PRESSURE, "MS5803 pressure sensor offline");
 		}
 	}
 
 	void update() override {}
 
-	float getPressure() {
+	/**
+	 * Refresh sensor.pressure() and sensor.temperature() in the background, without the blocking
+	 * wait of read(). Does nothing if a refresh is already under way.
+	 */
+	void beginRead() {
+		if (!readTask.isRunning()) {
+			startTask(readTask);
+		}
+	}
+
+	// One conversion for both sensor.pressure() and sensor.temperature()
+	void read() {
+		finishRead();
 		sensor.readSensor();
+	}
+
+	float getPressure() {
+		read();
 		return sensor.pressure();
 	}
 
 	float getTemp() {
-		sensor.readSensor();
+		read();
 		return sensor.temperature();
 	}
 
+	// Abandon a background read so that a blocking one can use the bus. The sensor ignores a
+	// new command until its conversion is done, so wait that out first.
+	void finishRead() {
+		if (readTask.isRunning()) {
+			stopTask(readTask);
+			delay(sensor.conversionTime());
+		}
+	}
+
 	int error_code() {
 		return 0;
 	}
@@ -51,24 +92,33 @@ public:
 		int count = 0;
 		for (int i = 0; i < qty; ++i) {
 			float p_inst = getPressure();
-			#ifdef PRESSURE_CHECK
-				print("Pressure instant mbar;;;;; ");
-				println(p_inst);
-			#endif
+			LOG_TRACE(PRESSURE, "Pressure instant mbar;;;;; ", p_inst);
 			if (p_inst>0){
 				count = count +1;
 				sum += p_inst;
 			}
 		}
 		float p_avg = sum/count;
-		print("Pressure average mbar;;;;; ");
-		println(p_avg);
+		LOG_DEBUG(PRESSURE, "Pressure average mbar;;;;; ", p_avg);
 		if (p_avg >= min_pressure && p_avg <= max_pressure) {
 			return true;
 		} else {
-			Serial.print("Not within pressure, value: ");
-			Serial.println(p_avg);
+			LOG_WARN(PRESSURE, "Not within pressure, value: ", p_avg);
 			return false;
 		}
 	}
-};
\ No newline at end of file
+};
+
+inline bool PressureReadTask::step() {
+	KP_TASK_BEGIN();
+	owner.sensor.startPressure();
+	started = millis();
+	KP_TASK_AWAIT(millis() - started > owner.sensor.conversionTime());
+	owner.sensor.collectPressure();
+
+	owner.sensor.startTemperature();
+	started = millis();
+	KP_TASK_AWAIT(millis() - started > owner.sensor.conversionTime());
+	owner.sensor.collectTemperature();
+	KP_TASK_END();
+}
\ No newline at end of file
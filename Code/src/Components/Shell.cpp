@@ -1,6 +1,8 @@
 #include <Components/Shell.hpp>
 #include <Application/Application.hpp>
 #include <Application/Constants.hpp>
+#include <Application/Log.hpp>
+#include <Application/Parameters.hpp>
 #include <KPFoundation.hpp>
 #include <SD.h>
 #include <ArduinoJson.h>
@@ -8,410 +10,496 @@
 #include <sstream>
 #include <String>
 //#include <FileIO/SerialSD.hpp>
-#define cmnd_lambda [](Application & app, const std::string * args)
-#define CALL		(app, args)
+#define cmnd(name) void name(Application & app, const KPArgs & args)
 
 namespace Utility {
-	// returns true if str is a pos int
-	// assumes string correctness
-	bool is_posint(const char * str) {
-		for (int i = 0; str[i] != '\0'; ++i) {
-			if (str[i] > '9' || str[i] < '0') {
-				return false;
+	// Dumps can be far larger than the serial output buffer, so this one waits for room
+	void printFile(File & file, size_t length = SIZE_MAX) {
+		auto & out = KPSerialOutput::sharedInstance();
+		uint8_t chunk[64];
+		for (int size; length && (size = file.read(chunk, std::min(length, sizeof(chunk)))) > 0;) {
+			length -= size;
+			if (out.availableForWrite() < size) {
+				out.flush();
 			}
-		}
-		return true;
-	}
 
-	// returns true if str is a pos int
-	// displays a msg if it isn't
-	bool msg_posint(const char * str, int arg) {
-		bool posint = is_posint(str);
-		if (!posint) {
-			Serial.print("Error: argument ");
-			Serial.print(arg);
-			Serial.print(" needs to be a pos int.");
+			out.write(chunk, size);
 		}
-		return posint;
-	}
 
-	std::string readEntireFile(File & file) {
-		std::string contents;
-		while (-1 != file.peek()) {
-			contents.push_back(file.read());
-		}
-		return contents;
+		println();
 	}
 }  // namespace Utility
 
-void Shell::runFunction(const std::string * args, const unsigned short length) {
-	if (commands.find(args[0]) != commands.end()) {
-		if (length - 1 == commands.at(args[0]).n_args) {
-			Application & app = *static_cast<Application *>(controller);
-			commands.at(args[0]).function(app, args);
-		} else {
-			Serial.print("Bad arguments\n");
-		}
-	} else {
-		Serial.print("Bad command.\n");
+/*
+	cmnd(name) {
+		function
 	}
-}
 
-/*
-	addFunction(
-		"name",
-		n args,
-		cmnd_lambda { function });
+	then add command("name", Commands::name, ARG_SPECS) to the table
+	below, or command("name", Commands::name) if it takes no arguments.
 
-	You will have access to app and args[]. args[0] should always
-	be the same as the name of the command. They are C++ strings
+	The arguments are checked and converted against the specs before
+	the function runs. Read them with args.integer(i), args.real(i),
+	args.choice(i) or args.text(i), i counting from 0 after the name.
 */
 
-void Shell::setup() {
+namespace Args {
+	constexpr const char * LIGHTS[]	 = {LEDNames::IDLE, LEDNames::RUN, LEDNames::BATTERY};
+	constexpr const char * FORMATS[] = {"text", "binary"};
+
+	constexpr KPArgSpec EPOCH[]		= {intArg("epoch", 0)};
+	constexpr KPArgSpec ENABLED[]	= {intArg("enabled", 0, 1)};
+	constexpr KPArgSpec SECONDS[]	= {intArg("seconds", 0, 7 * 24 * 60 * 60L)};
+	constexpr KPArgSpec LIGHT[]		= {choiceArg("light", LIGHTS)};
+	constexpr KPArgSpec PATH[]		= {textArg("path")};
+	constexpr KPArgSpec SHIFT_PIN[] = {intArg("pin", 0, 31), intArg("level", 0, 1)};
+
+	constexpr KPArgSpec SETTING[]		= {textArg("section.key")};
+	constexpr KPArgSpec SETTING_VALUE[] = {textArg("section.key"), textArg("value")};
+
+	constexpr KPArgSpec PIN[]	= {intArg("pin", 0, NUM_DIGITAL_PINS - 1), intArg("level", 0, 1)};
+	constexpr KPArgSpec COLOR[] = {intArg("r", 0, 255), intArg("g", 0, 255), intArg("b", 0, 255)};
+	constexpr KPArgSpec STREAM[] = {intArg("ms", 50, 60000), choiceArg("format", FORMATS)};
+	constexpr KPArgSpec LOG[]
+		= {choiceArg("module", LogModule::NAMES), choiceArg("level", KPLog::LEVEL_NAMES)};
+}  // namespace Args
+
+namespace {
+	const char * describe(KPArgError error) {
+		switch (error) {
+		case KPArgError::notInteger:
+			return "not an integer";
+		case KPArgError::notNumber:
+			return "not a number";
+		case KPArgError::outOfRange:
+			return "out of range";
+		case KPArgError::notAChoice:
+			return "not one of the choices";
+		case KPArgError::truncated:
+			return "missing";
+		default:
+			return "invalid";
+		}
+	}
+
+	void printUsage(const ShellSpace::Command & command) {
+		print("Usage: ", command.name);
+		for (size_t i = 0; i < command.n_args; i++) {
+			print(" ");
+			KPArgParser::printSpec(KPSerialOutput::sharedInstance(), command.args[i]);
+		}
+
+		println();
+	}
+}  // namespace
+
+namespace Commands {
 	// run button
-	addFunction(
-		"sample_button_press",
-		0,
-		cmnd_lambda { app.sm.begin(); });
+	cmnd(sample_button_press) {
+		app.sm.begin();
+	}
 
 	// clean button
-	addFunction(
-		"clean_button_press",
-		0,
-		cmnd_lambda { app.csm.begin(); });
-	
+	cmnd(clean_button_press) {
+		app.csm.begin();
+	}
+
 	// halt the machine in the sample state
-	addFunction(
-		"sample_halt",
-		0,
-		cmnd_lambda { app.sm.halt(); });
+	cmnd(sample_halt) {
+		app.sm.halt();
+	}
 
 	// halt the clean state machine
-	addFunction(
-		"clean_halt",
-		0,
-		cmnd_lambda { app.csm.halt(); });
+	cmnd(clean_halt) {
+		app.csm.halt();
+	}
 
 	// halt all state machines
-	addFunction(
-		"halt",
-		0,
-		cmnd_lambda {
-			app.sm.halt();
-			app.csm.halt();
-		});
+	cmnd(halt) {
+		app.sm.halt();
+		app.csm.halt();
+	}
 
 	// print free ram
-	addFunction(
-		"mem",
-		0,
-		cmnd_lambda { Serial.println(free_ram()); });
-
-	addFunction(
-		"state_read",
-		0,
-		cmnd_lambda {
-			File file = SD.open("state.js", FILE_READ);
-			Serial.println(Utility::readEntireFile(file).c_str());
-			file.close();
-		});
-
-	addFunction(
-		"check_sample_flush_time",
-		0,
-		cmnd_lambda {
-			Serial.println(app.sm.getState<SampleStateFlush>(SampleStateNames::FLUSH).time);
-		});
-	
+	cmnd(mem) {
+		println(free_ram());
+	}
+
+	// print timing statistics of the repeating scheduled actions
+	cmnd(action_stats) {
+		ActionScheduler::sharedInstance().printStats();
+	}
+
+	// print how long each boot phase took
+	cmnd(boot_profile) {
+		app.boot.print();
+	}
+
+	// print the saved settings from the newest valid config slot
+	cmnd(state_read) {
+		size_t length;
+		File file = app.config.load(length);
+		if (!file) {
+			println("No valid config slot");
+			return;
+		}
+
+		println(file.name(), ":");
+		Utility::printFile(file, length);
+		file.close();
+	}
+
 	//Set time in Unix Epoch time - number of seconds since 1/1/1970 e.g. https://www.epochconverter.com/
-	addFunction(
-		"set_time",
-		1,
-		cmnd_lambda {
-			if (Utility::msg_posint(args[1].c_str(), 1)) {
-				app.clock.set(std::stoi(args[1]));
-			}
-		});
-	
+	cmnd(set_time) {
+		app.clock.set(args.integer(0));
+	}
+
+	// MCU vs RTC drift, applied timebase correction, RTC vs host drift and the aging offset
+	cmnd(clock_drift) {
+		app.clock.printDrift();
+	}
+
+	// fold the RTC drift measured between the last two set_time calls into the aging offset
+	cmnd(clock_trim) {
+		if (!app.clock.trim()) {
+			println("RTC drift not measured yet");
+		}
+		app.clock.printDrift();
+	}
+
+	// 1 to rescale the timebase by the measured MCU drift, 0 to run it uncorrected
+	cmnd(clock_correct) {
+		app.clock.setCorrectTimebase(args.integer(0));
+	}
+
 	//unix epoch time - seconds since January 1, 1970
-	addFunction(
-		"get_time",
-		0,
-		cmnd_lambda {
-			const auto timenow = now();
-			char time_string[50];
-			sprintf(time_string, "%u", timenow);
-			Serial.println(time_string);
-
-		});
-
-	addFunction(
-		"get_pressure",
-		0,
-		cmnd_lambda { Serial.println(app.pressure_sensor.getPressure()); });
-
-	addFunction(
-		"get_load",
-		1,
-		cmnd_lambda { Serial.println(app.load_cell.getLoad(stoi(args[1]))); });
-
-	addFunction(
-		"get_tared_load",
-		1,
-		cmnd_lambda { Serial.println(app.load_cell.getTaredLoad(stoi(args[1]))); });
-
-	addFunction(
-		"volt_load",
-		0,
-		cmnd_lambda { Serial.println(app.load_cell.getVoltage()); });
-
-	addFunction(
-		"sample_no_runs",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "last_cycle"};
-			app.reWrite(loc, app.sm.last_cycle, std::stoi(args[1]));
-		});
-
-	addFunction(
-		"sample_flush_time",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "flush_time"};
-			app.reWrite(loc,
-				app.sm.getState<SampleStateFlush>(SampleStateNames::FLUSH).time,
-				std::stoi(args[1]));
-		});
-
-	addFunction(
-		"sample_fill_time",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "fill_time"};
-			app.reWrite(loc,
-				app.sm.getState<SampleStateFlush>(SampleStateNames::FILL_TUBE).time,
-				std::stoi(args[1]));
-		});	
-
-	addFunction(
-		"sample_sample_time",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "sample_time"};
-			app.reWrite(loc,
-				app.sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).time,
-				std::stoi(args[1]));
-		});
-
-	addFunction(
-		"sample_sample_mass",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "sample_mass"};
-			app.reWrite(loc,
-				app.sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).mass,
-				std::stoi(args[1]));
-		});
-
-	addFunction(
-		"sample_idle_time",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "idle_time"};
-			app.reWrite(loc,
-				app.sm.getState<SampleStateIdle>(SampleStateNames::IDLE).time,
-				std::stoi(args[1]));
-		});
-
-	addFunction(
-		"sample_between_time",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "idle_time"};
-			app.reWrite(loc,
-				app.sm.getState<SampleStateIdle>(SampleStateNames::IDLE).time,
-				std::stoi(args[1])
-					- app.sm.getState<SampleStateOnramp>(SampleStateNames::ONRAMP).time
-					- app.sm.getState<SampleStateFlush>(SampleStateNames::FLUSH).time
-					- app.sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).time);
-		});
-
-	addFunction(
-		"sample_setup_time",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "setup_time"};
-			app.reWrite(loc,
-				app.sm.getState<SampleStateSetup>(SampleStateNames::SETUP).time,
-				std::stoi(args[1]));
-		});
-
-	addFunction(
-		"clean_sample_time",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"clean", "sample_time"};
-			app.reWrite(loc,
-				app.csm.getState<CleanStateSample>(CleanStateNames::SAMPLE).time,
-				std::stoi(args[1]));
-		});
-
-	addFunction(
-		"clean_idle_time",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"clean", "idle_time"};
-			app.reWrite(loc,
-				app.csm.getState<CleanStateIdle>(CleanStateNames::IDLE).time,
-				std::stoi(args[1]));
-		});
-
-	addFunction(
-		"clean_flush_time",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"clean", "flush_time"};
-			app.reWrite(loc,
-				app.csm.getState<CleanStateFlush>(CleanStateNames::FLUSH).time,
-				std::stoi(args[1]));
-		});
-
-	addFunction(
-		"sample_setup_tod_enabled",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "setup_tod_enabled"};
-			app.reWrite(loc,
-				app.sm.getState<SampleStateSetup>(SampleStateNames::SETUP).tod_enabled,
-				std::stoi(args[1]));
-		});
-	addFunction(
-		"sample_setup_tod",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"sample", "setup_tod"};
-			app.reWrite(loc,
-				app.sm.getState<SampleStateSetup>(SampleStateNames::SETUP).tod,
-				std::stoi(args[1]));
-		});
-	addFunction(
-		"min_pressure",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"pressure", "min_pressure"};
-			app.reWrite(loc, app.pressure_sensor.min_pressure, std::stoi(args[1]));
-		});
-
-	addFunction(
-		"max_pressure",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"pressure", "max_pressure"};
-			app.reWrite(loc, app.pressure_sensor.max_pressure, std::stoi(args[1]));
-		});
-
-	addFunction(
-		"led_set",
-		1,
-		cmnd_lambda { app.led.setLight(args[1].c_str()); });
-	addFunction(
-		"led_clear",
-		0,
-		cmnd_lambda { app.led.strip(); });
-
-	addFunction(
-		"file_read",
-		1,
-		cmnd_lambda {
-			File file = SD.open(args[1].c_str());
-			Serial.println(Utility::readEntireFile(file).c_str());
-			file.close();
-		});
-
-	addFunction(
-		"get_temperature",
-		0,
-		cmnd_lambda { Serial.println(app.pressure_sensor.getTemp()); });
-
-	addFunction(
-		"shift_manip",
-		2,
-		cmnd_lambda {
-			app.shift.setAllRegistersLow();
-			app.shift.setPin(std::stoi(args[1]), std::stoi(args[2]));  // write in skinny
-			app.shift.write();										   // write shifts wide*/
-		});
-
-	addFunction(
-		"pin_manip",
-		2,
-		cmnd_lambda { digitalWrite(stoi(args[1]), stoi(args[2])); });
-
-	addFunction(
-		"led_manip",
-		3,
-		cmnd_lambda { app.led.setColor(stoi(args[1]), stoi(args[2]), stoi(args[3])); });
-	addFunction(
-		"pump_on",
-		0,
-		cmnd_lambda { app.pump.on(); });
-
-	addFunction(
-		"pump_off",
-		0,
-		cmnd_lambda { app.pump.off(); });
-
-	addFunction(
-		"load_cell_offset",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"load_cell", "offset"};
-			app.reWrite(loc, app.load_cell.offset, std::stof(args[1]));
-		});
-
-	addFunction(
-		"load_cell_factor",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"load_cell", "factor"};
-			app.reWrite(loc, app.load_cell.factor, std::stof(args[1]));
-		});
-
-	addFunction(
-		"load_cell_offset_auto",
-		1,
-		cmnd_lambda {
-			const char * loc[2] = {"load_cell", "offset"};
-			app.reWrite(loc, app.load_cell.offset, app.load_cell.getLoad(stoi(args[1])));
-		});
-
-	addFunction(
-		"tare_load",
-		1,
-		cmnd_lambda { app.load_cell.reTare(stoi(args[1])); });
-
-	addFunction(
-		"file_reset",
-		1,
-		cmnd_lambda { SD.remove(args[1].c_str()); });
-
-	addFunction(
-		"load_spam",
-		1,
-		cmnd_lambda {
-			int no = stoi(args[1]);
-			for (int i = 0; i < no; ++i) {
-				Serial.print(i + 1);
-				Serial.print(". ");
-				Serial.println(app.load_cell.readGrams());
-			}
-		});
+	cmnd(get_time) {
+		println(app.clock.timestamp());
+	}
+
+	cmnd(get_pressure) {
+		println(app.pressure_sensor.getPressure());
+	}
+
+	cmnd(get_load) {
+		println(app.load_cell.getLoad());
+	}
+
+	cmnd(get_tared_load) {
+		println(app.load_cell.getTaredLoad());
+	}
+
+	// filtered load, its standard deviation and the conversions filtered so far
+	cmnd(load_stats) {
+		println(app.load_cell.getLoad(), ";", sqrt(app.load_cell.loadVariance()), ";",
+			app.load_cell.conversions, app.load_cell.isSettled() ? "" : ";settling");
+	}
+
+	cmnd(volt_load) {
+		println(app.load_cell.getVoltage());
+	}
+
+	// print a setting, e.g. "get sample.flush_time"
+	cmnd(get) {
+		auto parameter = Parameters::find(args.text(0));
+		if (!parameter) {
+			println("Error: unknown setting ", args.text(0));
+			return;
+		}
+
+		Parameters::print(app, *parameter);
+	}
+
+	// change a setting, e.g. "set sample.flush_time 50"; saved like every config change
+	cmnd(set) {
+		auto parameter = Parameters::find(args.text(0));
+		if (!parameter) {
+			println("Error: unknown setting ", args.text(0));
+			return;
+		}
+
+		KPStringView token(args.text(1), strlen(args.text(1)));
+		auto error = Parameters::set(app, *parameter, token);
+		if (error != KPArgError::none) {
+			println("Error: ", args.text(0), " \"", args.text(1), "\" is ", describe(error));
+			print("Expected ");
+			KPArgParser::printSpec(KPSerialOutput::sharedInstance(), parameter->spec);
+			println();
+			return;
+		}
+
+		app.configChanged();
+	}
+
+	// print every setting
+	cmnd(config_dump) {
+		for (auto parameter = Parameters::begin(); parameter != Parameters::end(); ++parameter) {
+			Parameters::print(app, *parameter);
+		}
+	}
 
+	// hold the following setting changes in memory until config_commit
+	cmnd(config_begin) {
+		app.beginConfig();
+	}
+
+	// write all setting changes to SD at once, skipped if nothing changed
+	cmnd(config_commit) {
+		bool dirty = app.isConfigDirty();
+		app.commitConfig();
+		println(dirty ? "Config saved" : "Config unchanged");
+	}
+
+	// idle time such that cycles start the given number of seconds apart
+	cmnd(sample_between_time) {
+		app.reWrite(app.sm.getState<SampleStateIdle>(SampleStateNames::IDLE).time,
+			args.integer(0)
+				- app.sm.getState<SampleStateOnramp>(SampleStateNames::ONRAMP).time
+				- app.sm.getState<SampleStateFlush>(SampleStateNames::FLUSH).time
+				- app.sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).time);
+	}
+
+	cmnd(led_set) {
+		app.led.setLight(Args::LIGHTS[args.choice(0)]);
+	}
+
+	cmnd(led_clear) {
+		app.led.strip();
+	}
+
+	cmnd(file_read) {
+		File file = SD.open(args.text(0));
+		Utility::printFile(file);
+		file.close();
+	}
+
+	cmnd(get_temperature) {
+		println(app.pressure_sensor.getTemp());
+	}
+
+	cmnd(shift_manip) {
+		app.shift.setAllRegistersLow();
+		app.shift.setPin(args.integer(0), args.integer(1));  // write in skinny
+		app.shift.write();										   // write shifts wide*/
+	}
+
+	cmnd(pin_manip) {
+		digitalWrite(args.integer(0), args.integer(1));
+	}
+
+	cmnd(led_manip) {
+		app.led.setColor(args.integer(0), args.integer(1), args.integer(2));
+	}
+
+	cmnd(pump_on) {
+		app.pump.on();
+	}
+
+	cmnd(pump_off) {
+		app.pump.off();
+	}
+
+	cmnd(load_cell_offset_auto) {
+		app.reWrite(app.load_cell.offset, app.load_cell.getLoad());
+	}
+
+	cmnd(tare_load) {
+		app.load_cell.reTare();
+	}
+
+	cmnd(file_reset) {
+		SD.remove(args.text(0));
+	}
+
+	// stream load, pressure, temperature and state every ms milliseconds while the sampler runs
+	cmnd(stream) {
+		app.telemetry.start(args.integer(0), args.choice(1) == 1);
+	}
+
+	// runtime log level of a module; levels above the module's compiled ceiling stay silent
+	cmnd(log_level) {
+		auto module = args.choice(0);
+		KPLog::level(module) = args.choice(1);
+		if (args.choice(1) > LogModule::CEILINGS[module]) {
+			println("Note: ", LogModule::NAMES[module], " is compiled up to ",
+				KPLog::LEVEL_NAMES[LogModule::CEILINGS[module]]);
+		}
+	}
+
+	// runtime level and compiled ceiling of every module
+	cmnd(log_levels) {
+		for (size_t i = 0; i < LogModule::COUNT; i++) {
+			println(LogModule::NAMES[i], " ", KPLog::LEVEL_NAMES[KPLog::level(i)], " (compiled ",
+				KPLog::LEVEL_NAMES[LogModule::CEILINGS[i]], ")");
+		}
+	}
+
+	cmnd(stream_off) {
+		app.telemetry.stop();
+		println("Telemetry: ", app.telemetry.sent, " sent, ", app.telemetry.dropped, " dropped");
+	}
+}  // namespace Commands
+
+namespace {
+	using ShellSpace::command;
+
+	// In flash, looked up through a perfect hash computed at compile time
+	constexpr ShellSpace::Command commands[] = {
+		command("sample_button_press", Commands::sample_button_press),
+		command("clean_button_press", Commands::clean_button_press),
+		command("sample_halt", Commands::sample_halt),
+		command("clean_halt", Commands::clean_halt),
+		command("halt", Commands::halt),
+		command("mem", Commands::mem),
+		command("action_stats", Commands::action_stats),
+		command("boot_profile", Commands::boot_profile),
+		command("state_read", Commands::state_read),
+		command("set_time", Commands::set_time, Args::EPOCH),
+		command("clock_drift", Commands::clock_drift),
+		command("clock_trim", Commands::clock_trim),
+		command("clock_correct", Commands::clock_correct, Args::ENABLED),
+		command("get_time", Commands::get_time),
+		command("get_pressure", Commands::get_pressure),
+		command("get_load", Commands::get_load),
+		command("get_tared_load", Commands::get_tared_load),
+		command("load_stats", Commands::load_stats),
+		command("volt_load", Commands::volt_load),
+		command("get", Commands::get, Args::SETTING),
+		command("set", Commands::set, Args::SETTING_VALUE),
+		command("config_dump", Commands::config_dump),
+		command("config_begin", Commands::config_begin),
+		command("config_commit", Commands::config_commit),
+		command("sample_between_time", Commands::sample_between_time, Args::SECONDS),
+		command("led_set", Commands::led_set, Args::LIGHT),
+		command("led_clear", Commands::led_clear),
+		command("file_read", Commands::file_read, Args::PATH),
+		command("get_temperature", Commands::get_temperature),
+		command("shift_manip", Commands::shift_manip, Args::SHIFT_PIN),
+		command("pin_manip", Commands::pin_manip, Args::PIN),
+		command("led_manip", Commands::led_manip, Args::COLOR),
+		command("pump_on", Commands::pump_on),
+		command("pump_off", Commands::pump_off),
+		command("load_cell_offset_auto", Commands::load_cell_offset_auto),
+		command("tare_load", Commands::tare_load),
+		command("file_reset", Commands::file_reset, Args::PATH),
+		command("stream", Commands::stream, Args::STREAM),
+		command("stream_off", Commands::stream_off),
+		command("log_level", Commands::log_level, Args::LOG),
+		command("log_levels", Commands::log_levels),
+	};
+
+	constexpr size_t COMMAND_SLOTS = 512;
+	constexpr auto seed			   = KPPerfectHash::findSeed(commands, COMMAND_SLOTS);
+	static_assert(seed != KPPerfectHash::NO_SEED, "No perfect hash seed for the shell commands");
+
+	constexpr KPCommandTable<ShellSpace::Command, sizeof(commands) / sizeof(commands[0]),
+		COMMAND_SLOTS>
+		table(commands, seed);
+}  // namespace
+
+void Shell::runFunction(const KPStringView * args, const unsigned short length) {
+	auto command = table.find(args[0].data, args[0].size);
+	if (!command) {
+		println("Error: unknown command ", args[0].c_str());
+		return;
+	}
+
+	if (length - 1u != command->n_args) {
+		println("Error: ", command->name, " takes ", command->n_args, " argument(s)");
+		printUsage(*command);
+		return;
+	}
+
+	KPArgValue values[ShellSpace::MAX_ARGS];
+	for (size_t i = 0; i < command->n_args; i++) {
+		auto error = KPArgParser::parse(command->args[i], args[i + 1], values[i]);
+		if (error != KPArgError::none) {
+			println("Error: ", command->name, " ", command->args[i].name, " \"",
+				args[i + 1].c_str(), "\" is ", describe(error));
+			printUsage(*command);
+			return;
+		}
+	}
+
+	Application & app = *static_cast<Application *>(controller);
+	command->function(app, KPArgs(values));
 }
 
-void Shell::addFunction(const char * name, const unsigned short n_args, ShellSpace::func function) {
-	ShellSpace::func_args entry;
-	entry.function = function;
-	entry.n_args   = n_args;
-	commands[name] = entry;
-}
\ No newline at end of file
+namespace {
+	constexpr size_t REPLY_HEADER = 6;
+
+	void reply(uint8_t seq, uint8_t id, ShellSpace::FrameStatus status, uint8_t arg = 0,
+		KPArgError error = KPArgError::none, uint8_t * payload = nullptr, size_t output = 0) {
+		uint8_t header[REPLY_HEADER + 1];
+		payload = payload ? payload : header;
+		uint8_t fields[REPLY_HEADER] = {ShellSpace::REPLY, seq, id, status, arg, uint8_t(error)};
+		memcpy(payload, fields, sizeof(fields));
+		payload[REPLY_HEADER + output] = 0;
+		KPFrame::send(KPSerialOutput::sharedInstance(), payload, REPLY_HEADER + output + 1);
+	}
+
+	void list(uint8_t seq) {
+		for (size_t id = 0; id < table.size(); id++) {
+			auto & command = commands[id];
+			uint8_t payload[KPFrame::MAX_PAYLOAD];
+			KPFrame::Writer out(payload, sizeof(payload));
+			out.u8(ShellSpace::ENTRY).u8(seq).u8(id).u8(command.n_args);
+			for (size_t i = 0; i < command.n_args; i++) {
+				out.u8(uint8_t(command.args[i].type));
+			}
+
+			out.text(command.name);
+			KPFrame::send(KPSerialOutput::sharedInstance(), payload, out.size());
+		}
+	}
+}  // namespace
+
+// Same table and argument specs as the text commands; fields replace the tokens
+void Shell::runFrame(const uint8_t * payload, size_t size) {
+	KPFrame::Reader in(payload, size);
+	uint8_t type, seq, id = 0;
+	if (!in.u8(type) || !in.u8(seq)) {
+		return;
+	}
+
+	if (type == ShellSpace::LIST && in.done()) {
+		list(seq);
+		return;
+	}
+
+	if (type != ShellSpace::COMMAND || !in.u8(id)) {
+		reply(seq, id, ShellSpace::MALFORMED);
+		return;
+	}
+
+	if (id >= table.size()) {
+		reply(seq, id, ShellSpace::UNKNOWN_COMMAND);
+		return;
+	}
+
+	auto & command = commands[id];
+	KPArgValue values[ShellSpace::MAX_ARGS];
+	for (size_t i = 0; i < command.n_args; i++) {
+		auto error = KPArgParser::decode(command.args[i], in, values[i]);
+		if (error != KPArgError::none) {
+			reply(seq, id, ShellSpace::BAD_ARGUMENT, i, error);
+			return;
+		}
+	}
+
+	if (!in.done()) {
+		reply(seq, id, ShellSpace::MALFORMED);
+		return;
+	}
+
+	// The command's output goes into the reply, after the header and before the terminator
+	uint8_t response[KPFrame::MAX_PAYLOAD];
+	auto & out = KPSerialOutput::sharedInstance();
+	out.beginCapture(response + REPLY_HEADER, sizeof(response) - REPLY_HEADER - 1);
+	Application & app = *static_cast<Application *>(controller);
+	command.function(app, KPArgs(values));
+	bool cut;
+	size_t output = out.endCapture(cut);
+	reply(seq, id, cut ? ShellSpace::TRUNCATED : ShellSpace::OK, 0, KPArgError::none, response,
+		output);
+}
@@ -1,24 +1,62 @@
 #pragma once
-#include <map>
-#include <string>
 #include <KPFoundation.hpp>
+#include <KPCommandLine.hpp>
+#include <KPCommandTable.hpp>
+#include <KPArgs.hpp>
 
 class Application;
 namespace ShellSpace {
-	using func = void (*)(Application & app, const std::string * args);
-	struct func_args {
+	// Most arguments a command line can carry after the command name
+	constexpr size_t MAX_ARGS = 7;
+
+	/*
+		Binary frames (KPFrame.hpp); the first two payload bytes are type and sequence number.
+		The host picks the sequence number and gets it back in every reply to the request.
+
+		COMMAND  [0x01][seq][id][fields]      id = position in the table, see LIST
+		REPLY    [0x81][seq][id][status][argument index][KPArgError][output, zero terminated]
+		LIST     [0x02][seq]
+		ENTRY    [0x82][seq][id][n args][KPArgType per arg][name, zero terminated]  one per command
+
+		A command run from a frame prints nothing on the port: whatever it would print (the value
+		of get, get_load, ...) comes back as the REPLY's output instead, TRUNCATED if it did not
+		fit in one frame.
+
+		Unsolicited, while "stream <ms> binary" runs; seq counts records so the host sees drops:
+		TELEMETRY [0x83][seq][u32 epoch s][u16 ms][f32 load][f32 mbar][f32 deg C][state name]
+	*/
+	enum FrameType : uint8_t {
+		COMMAND	  = 0x01,
+		LIST	  = 0x02,
+		REPLY	  = 0x81,
+		ENTRY	  = 0x82,
+		TELEMETRY = 0x83
+	};
+	enum FrameStatus : uint8_t { OK, UNKNOWN_COMMAND, MALFORMED, BAD_ARGUMENT, TRUNCATED };
+
+	using func = void (*)(Application & app, const KPArgs & args);
+	struct Command {
+		const char * name;
 		func function;
-		unsigned short n_args;
+		const KPArgSpec * args;
+		size_t n_args;
 	};
 
+	constexpr Command command(const char * name, func function) {
+		return {name, function, nullptr, 0};
+	}
+
+	template <size_t N>
+	constexpr Command command(const char * name, func function, const KPArgSpec (&args)[N]) {
+		static_assert(N <= MAX_ARGS, "Too many arguments for one command line");
+		return {name, function, args, N};
+	}
+
 };	// namespace ShellSpace
 
 class Shell : public KPComponent {
 public:
-	std::map<std::string, ShellSpace::func_args> commands;
-
 	Shell(const char * name, KPController * controller) : KPComponent(name, controller){};
-	void setup() override;
-	void runFunction(const std::string *, const unsigned short);
-	void addFunction(const char *, const unsigned short, ShellSpace::func);
-};
\ No newline at end of file
+	void runFunction(const KPStringView *, const unsigned short);
+	void runFrame(const uint8_t * payload, size_t size);
+};
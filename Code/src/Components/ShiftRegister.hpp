@@ -22,6 +22,7 @@
 #pragma once
 #include <KPFoundation.hpp>
 #include <SPI.h>
+#include <Application/Log.hpp>
 
 class ShiftRegister : public KPComponent {
 public:
@@ -123,12 +124,7 @@ public:
 		digitalWrite(latchPin, LOW);
 		for (int i = registersCount - 1; i >= 0; i--) {
 			shiftOut(dataPin, clockPin, bitOrder, registers[i]);
-#ifdef SHIFTDEBUG
-			Serial.print("Changing register: ");
-			Serial.print(i);
-			Serial.print(" to ");
-			Serial.println(registers[i]);
-#endif
+			LOG_TRACE(SHIFT, "Changing register: ", i, " to ", registers[i]);
 		}
 		digitalWrite(latchPin, HIGH);
 	}
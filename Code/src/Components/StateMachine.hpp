@@ -37,7 +37,7 @@ public:
 	}
 
 	void setup() override {
-		Serial.print("StateMachine setup");
+		print("StateMachine setup");
 	}
 
 	const char * getCurrentStateName() {
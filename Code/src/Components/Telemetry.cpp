@@ -0,0 +1,62 @@
+#include <Components/Telemetry.hpp>
+#include <Application/Application.hpp>
+#include <KPFrame.hpp>
+
+void Telemetry::start(long ms, bool binary) {
+	stop();
+	this->binary = binary;
+	period		 = ms;
+	sent		 = 0;
+	dropped		 = 0;
+	handle = runForever(ms, "telemetry", [this]() { sendRecord(); }, ActionTiming::skip);
+}
+
+void Telemetry::stop() {
+	cancel(handle);
+	period = 0;
+}
+
+bool Telemetry::send(const uint8_t * data, size_t size) {
+	auto & out = KPSerialOutput::sharedInstance();
+	if (out.availableForWrite() < static_cast<int>(size)) {
+		dropped++;
+		return false;
+	}
+
+	out.write(data, size);
+	sent++;
+	return true;
+}
+
+void Telemetry::sendRecord() {
+	Application & app = *static_cast<Application *>(controller);
+	float load		  = app.load_cell.getLoad();
+	// Last completed conversion; a blocking read would hold the scheduler for its two waits
+	float pressure	  = app.pressure_sensor.sensor.pressure();
+	float temperature = app.pressure_sensor.sensor.temperature();
+	app.pressure_sensor.beginRead();
+
+	const char * state = "off";
+	if (app.sm.isBusy()) {
+		state = app.sm.getCurrentStateName();
+	} else if (app.csm.isBusy()) {
+		state = app.csm.getCurrentStateName();
+	}
+
+	if (!binary) {
+		KPStringBuilder<96> line(
+			"T,", app.clock.timestamp(), ",", load, ",", pressure, ",", temperature, ",", state, "\n");
+		send(reinterpret_cast<const uint8_t *>(static_cast<char *>(line)), line.size());
+		return;
+	}
+
+	auto ms = app.clock.epochMillis();
+	uint8_t payload[KPFrame::MAX_PAYLOAD];
+	KPFrame::Writer out(payload, sizeof(payload));
+	out.u8(ShellSpace::TELEMETRY).u8(seq++).u32(ms / 1000).u16(ms % 1000);
+	out.f32(load).f32(pressure).f32(temperature).text(state);
+
+	// Packed first so the room check covers the whole frame
+	uint8_t frame[KPFrame::MAX_FRAME];
+	send(frame, KPFrame::pack(payload, out.size(), frame));
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <Action.hpp>
+
+/**
+ * Streams load, pressure, temperature and state at a fixed rate through the shared scheduler,
+ * as compact text lines or binary frames. A record is dropped (and counted) rather than queued
+ * in part when the serial output buffer has no room for it, so a slow host never stalls the loop
+ * or receives a torn record. Pressure and temperature come from the latest background conversion,
+ * so they trail the load by up to one period.
+ *
+ * Text:   T,<epoch.mmm>,<load>,<pressure>,<temperature>,<state>
+ * Binary: [0x83][seq][u32 epoch s][u16 ms][f32 load][f32 pressure][f32 temperature][state]
+ */
+class Telemetry : public KPComponent {
+private:
+	ActionHandle handle;
+	bool binary = false;
+	uint8_t seq = 0;
+
+	void sendRecord();
+	bool send(const uint8_t * data, size_t size);
+
+public:
+	long period			  = 0;
+	unsigned long sent	  = 0;
+	unsigned long dropped = 0;
+
+	Telemetry(const char * name, KPController * controller) : KPComponent(name, controller) {}
+
+	/**
+	 * Start (or retime) the stream
+	 *
+	 * @param ms Period between records
+	 * @param binary true for binary frames, false for text lines
+	 */
+	void start(long ms, bool binary);
+	void stop();
+
+	bool isStreaming() const {
+		return period > 0;
+	}
+};
@@ -1,28 +1,22 @@
 #pragma once
 #include <KPFoundation.hpp>
 #include <SD.h>
-#include <string>
+#include <Application/Log.hpp>
 
 class CSVWriter {
 public:
 	const char * dir;
 	CSVWriter(const char * dir) : dir(dir) {
 	}
-	void writeStrings(const std::string * strs, int len) {
+	// Print the values back to back as one line
+	template <typename... Types>
+	void writeLine(Types &&... values) {
 		File file = SD.open(dir, FILE_WRITE);
-		for (int i = 0; i < len; ++i) {
-			file.print(strs[i].c_str());
-			//if (i != len - 1)
-			//	file.print(" ");
-		}
+		printTo(file, std::forward<Types>(values)...);
 		file.write("\n");
-#ifdef WRITERDEBUG
 		if (file) {
-			Serial.print("Written to ");
-			Serial.print(dir);
-			Serial.print("\n");
+			LOG_TRACE(STORAGE, "Written to ", dir);
 		}
-#endif
 		file.close();
 	}
 };
\ No newline at end of file
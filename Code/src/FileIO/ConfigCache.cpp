@@ -0,0 +1,55 @@
+#include <FileIO/ConfigCache.hpp>
+#include <KPFrame.hpp>
+#include <FlashStorage.h>
+
+namespace {
+	constexpr uint32_t MAGIC = 0x4843464B;	// "KFCH"
+
+	struct Image {
+		uint32_t magic;
+		uint32_t layout;  // Parameters::layout() when written
+		uint32_t seq;
+		uint16_t slotCrc;
+		uint16_t count;
+		uint32_t values[Parameters::MAX_PARAMETERS];
+		uint16_t crc;
+	};
+
+	FlashStorage(cache, Image);
+
+	uint16_t checksum(const Image & image) {
+		return KPFrame::crc16(reinterpret_cast<const uint8_t *>(&image), offsetof(Image, crc));
+	}
+
+	bool valid(const Image & image) {
+		return image.magic == MAGIC && image.layout == Parameters::layout()
+			   && image.crc == checksum(image);
+	}
+}  // namespace
+
+namespace ConfigCache {
+	bool apply(Application & app, uint32_t seq, uint16_t crc, bool any) {
+		Image image = cache.read();
+		if (!valid(image) || (!any && (image.seq != seq || image.slotCrc != crc))) {
+			return false;
+		}
+
+		Parameters::unpack(app, image.values);
+		return true;
+	}
+
+	void store(Application & app, uint32_t seq, uint16_t crc) {
+		Image image{};
+		image.magic	  = MAGIC;
+		image.layout  = Parameters::layout();
+		image.seq	  = seq;
+		image.slotCrc = crc;
+		image.count	  = Parameters::pack(app, image.values);
+		image.crc	  = checksum(image);
+
+		Image current = cache.read();
+		if (memcmp(&current, &image, sizeof(image)) != 0) {
+			cache.write(image);
+		}
+	}
+}  // namespace ConfigCache
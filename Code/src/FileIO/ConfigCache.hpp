@@ -0,0 +1,25 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <Application/Parameters.hpp>
+
+class Application;
+
+/**
+ * Binary copy of the parameter set in internal flash, tagged with the sequence number and CRC
+ * of the config slot it came from. At boot it stands in for the JSON parse as long as the SD
+ * card still holds that same slot, and it is the only source of settings without a card.
+ * Written only when the settings on the card change, to spare the flash rows.
+ */
+namespace ConfigCache {
+	/**
+	 * Apply the cached parameters
+	 *
+	 * @param seq, crc Identity of the current config slot
+	 * @param any Accept a cache from any slot, for booting without one
+	 * @return true if the cache was valid (and matched) and has been applied
+	 */
+	bool apply(Application & app, uint32_t seq, uint16_t crc, bool any = false);
+
+	// Cache the current parameters as the content of the given slot, if they differ
+	void store(Application & app, uint32_t seq, uint16_t crc);
+}  // namespace ConfigCache
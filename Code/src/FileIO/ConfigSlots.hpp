@@ -0,0 +1,215 @@
+#pragma once
+#include <KPFoundation.hpp>
+#include <KPFrame.hpp>
+#include <SD.h>
+#include <Application/Log.hpp>
+
+/**
+ * Two fixed-size slot files for the configuration, written alternately. Each slot holds a
+ * header (magic, sequence number, length, CRC) followed by the payload. A save overwrites the
+ * older slot in place and only then counts as the newest, so a brown-out during a save leaves
+ * the previous configuration intact; load() picks the newest slot whose CRC checks out.
+ * Overwriting in place also avoids the directory entry delete and create of a fresh file.
+ */
+class ConfigSlots {
+public:
+	static constexpr uint32_t MAGIC		= 0x4346474B;  // "KGFC"
+	static constexpr size_t SLOT_SIZE	= 1024;
+	static constexpr size_t MAX_PAYLOAD = SLOT_SIZE - 12;
+
+private:
+	struct Header {
+		uint32_t magic;
+		uint32_t seq;
+		uint16_t length;
+		uint16_t crc;
+	};
+
+	static_assert(sizeof(Header) == SLOT_SIZE - MAX_PAYLOAD, "Unexpected slot header padding");
+
+	const char * paths[2];
+	int active		= -1;
+	uint32_t seq	= 0;
+	uint16_t crc	= 0;
+	uint16_t length = 0;
+
+	// CRC over sequence number, length and payload
+	static uint16_t checksum(const Header & header, const uint8_t * data, size_t size,
+		uint16_t crc = 0xFFFF) {
+		crc = KPFrame::crc16(reinterpret_cast<const uint8_t *>(&header.seq), 6, crc);
+		return KPFrame::crc16(data, size, crc);
+	}
+
+	// Passes the payload on to the slot file, checksumming it on the way
+	class PayloadWriter : public Print {
+	public:
+		File & file;
+		uint16_t crc;
+		size_t written = 0;
+
+		PayloadWriter(File & file, uint16_t crc) : file(file), crc(crc) {}
+
+		size_t write(const uint8_t * data, size_t size) override {
+			size = file.write(data, size);
+			crc	 = KPFrame::crc16(data, size, crc);
+			written += size;
+			return size;
+		}
+
+		size_t write(uint8_t c) override {
+			return write(&c, 1);
+		}
+	};
+
+	// Reads and checks the slot's header and payload CRC, leaving the file at the payload
+	static bool verify(File & file, Header & header) {
+		if (file.read(&header, sizeof(header)) != sizeof(header) || header.magic != MAGIC
+			|| header.length > MAX_PAYLOAD) {
+			return false;
+		}
+
+		uint8_t chunk[64];
+		uint16_t crc = checksum(header, nullptr, 0);
+		for (size_t left = header.length; left > 0;) {
+			int size = file.read(chunk, std::min(left, sizeof(chunk)));
+			if (size <= 0) {
+				return false;
+			}
+
+			crc = KPFrame::crc16(chunk, size, crc);
+			left -= size;
+		}
+
+		file.seek(sizeof(header));
+		return crc == header.crc;
+	}
+
+public:
+	ConfigSlots(const char * a, const char * b) : paths{a, b} {}
+
+	/**
+	 * Find the newest valid slot without reading it out
+	 *
+	 * @return true if there is one; activeSeq() and activeCrc() then identify it
+	 */
+	bool scan() {
+		active = -1;
+		Header newest{};
+		for (int i = 0; i < 2; i++) {
+			File file = SD.open(paths[i], FILE_READ);
+			Header header;
+			if (!file) {
+				continue;
+			}
+
+			if (!verify(file, header)) {
+				LOG_WARN(STORAGE, paths[i], " is not a valid config slot");
+			} else if (active == -1 || static_cast<int32_t>(header.seq - newest.seq) > 0) {
+				active = i;
+				newest = header;
+			}
+
+			file.close();
+		}
+
+		seq	   = newest.seq;
+		crc	   = newest.crc;
+		length = newest.length;
+		return active != -1;
+	}
+
+	/**
+	 * Find the newest valid slot
+	 *
+	 * @param length Payload length
+	 * @return File Open at the start of the payload; false if no slot is valid
+	 */
+	File load(size_t & length) {
+		if (!scan()) {
+			return File();
+		}
+
+		length	  = this->length;
+		File file = SD.open(paths[active], FILE_READ);
+		file.seek(sizeof(Header));
+		return file;
+	}
+
+	/**
+	 * Write the payload to the inactive slot; it becomes the active one once it is on the card
+	 *
+	 * @return true if the payload was written
+	 */
+	bool save(const uint8_t * data, size_t size) {
+		return save(size, [data, size](Print & out) { out.write(data, size); });
+	}
+
+	/**
+	 * Write the payload to the inactive slot straight from its source, without a copy in RAM.
+	 * The header is completed once the payload is in.
+	 *
+	 * @param size Payload length; the writer must produce exactly this many bytes
+	 * @param writer Called once with a Print to write the payload to
+	 * @return true if the payload was written
+	 */
+	template <typename Writer>
+	bool save(size_t size, Writer writer) {
+		if (size > MAX_PAYLOAD) {
+			LOG_ERROR(STORAGE, "Config of ", size, " bytes does not fit a slot");
+			return false;
+		}
+
+		int target = active == 0 ? 1 : 0;
+		// Without O_APPEND or O_TRUNC, so the existing clusters are overwritten in place
+		File file = SD.open(paths[target], O_READ | O_WRITE | O_CREAT);
+		if (!file) {
+			LOG_ERROR(STORAGE, "Could not open ", paths[target]);
+			return false;
+		}
+
+		// Without its magic until the payload is in, so a brown-out in between leaves no valid slot
+		Header header{0, seq + 1, static_cast<uint16_t>(size), 0};
+		auto raw	 = reinterpret_cast<const uint8_t *>(&header);
+		bool written = file.seek(0) && file.write(raw, sizeof(header)) == sizeof(header);
+		PayloadWriter payload(file, checksum(header, nullptr, 0));
+		if (written) {
+			writer(static_cast<Print &>(payload));
+			written = payload.written == size;
+		}
+
+		// Allocate the whole slot on first use so later saves never grow the file
+		for (uint8_t zero[32]{}; written && file.size() < SLOT_SIZE;) {
+			written = file.write(zero, std::min(sizeof(zero), SLOT_SIZE - file.size())) > 0;
+		}
+
+		header.magic = MAGIC;
+		header.crc	 = payload.crc;
+		written		 = written && file.seek(0) && file.write(raw, sizeof(header)) == sizeof(header);
+
+		file.close();
+		if (!written) {
+			LOG_ERROR(STORAGE, "Could not write ", paths[target]);
+			return false;
+		}
+
+		active = target;
+		seq	   = header.seq;
+		crc	   = header.crc;
+		length = header.length;
+		return true;
+	}
+
+	// Sequence number and CRC of the slot found or saved last; together they identify its content
+	uint32_t activeSeq() const {
+		return seq;
+	}
+
+	uint16_t activeCrc() const {
+		return crc;
+	}
+
+	// Path of the slot loaded or saved last, nullptr if none
+	const char * activePath() const {
+		return active == -1 ? nullptr : paths[active];
+	}
+};
@@ -1,16 +1,16 @@
 #include <Procedures/SampleStates.hpp>
 #include <Application/Application.hpp>
-#include <time.h>
-#include <sstream>
-#include <String>
+#include <Application/Log.hpp>
 
 bool pumpOff = 1;
 bool flushVOff = 1;
 bool sampleVOff = 1;
 bool pressureEnded = 0;
-unsigned long sample_start_time;
-unsigned long sample_end_time;
-short load_count = 0;
+uint64_t sample_start_time;
+uint64_t sample_end_time;
+bool wt_offset_taken = 0;
+uint32_t last_conversion = 0;
+uint64_t last_load_log = 0;
 float prior_load = 0;
 int sampler = 1;
 
@@ -26,26 +26,39 @@ void writeLatch(bool controlPin, ShiftRegister & shift) {
 	shift.write();
 }
 
-// Idle
+// Idle: program the RTC alarm for the next cycle start and wait for it
 void SampleStateIdle::enter(KPStateMachine & sm) {
 	Application & app = *static_cast<Application *>(sm.controller);
-	if (app.sm.current_cycle < app.sm.last_cycle)
-		setTimeCondition(time, [&]() { sm.transitionTo(SampleStateNames::ONRAMP); });
-	else
+	if (app.sm.current_cycle < app.sm.last_cycle) {
+		clock = &app.clock;
+		cycle_start = clock->epoch() + time;
+		app.clock.setAlarm(cycle_start);
+		setCondition([&]() { return clock->epoch() >= cycle_start; },
+			[&]() { sm.transitionTo(SampleStateNames::ONRAMP); });
+	} else
 		sm.transitionTo(SampleStateNames::FINISHED);
 }
 
+void SampleStateIdle::leave(KPStateMachine & sm) {
+	Application & app = *static_cast<Application *>(sm.controller);
+	app.clock.clearAlarm();
+}
+
+unsigned long SampleStateIdle::idleTime() const {
+	if (!clock) {
+		return KPState::idleTime();
+	}
+
+	auto remaining = (uint64_t) cycle_start * 1000 - clock->epochMillis();
+	return (int64_t) remaining > 0 ? remaining : 0;
+}
+
 // Setup: Change LED color, wait SETUP_TIME to allow for delayed sampling start
 void SampleStateSetup::enter(KPStateMachine & sm) {
 	Application & app = *static_cast<Application *>(sm.controller);
 	app.led.setRun();
 	//get and print time
-	const auto timenow = now();
-	std::stringstream ss;
-	ss << timenow;
-	std::string time_string = ss.str();
-	std::string strings[2] = {time_string, ",New Sampling Sequence"};
-	csvw.writeStrings(strings, 2);
+	csvw.writeLine(app.clock.timestamp(), ",New Sampling Sequence");
 	setTimeCondition(time, [&]() { sm.next();});
 }
 
@@ -58,7 +71,7 @@ void SampleStateFillTubeOnramp::enter(KPStateMachine & sm) {
 		app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH);// write in skinny
 		app.shift.write();								   // write shifts wide*/
 		flushVOff = 0;
-		println("Flush valve turning on");
+		LOG_INFO(SAMPLE, "Flush valve turning on");
 		sampleVOff = 1;
 	}
 	setTimeCondition(time, [&]() { sm.next();});
@@ -73,7 +86,7 @@ void SampleStateFillTube::enter(KPStateMachine & sm) {
 		app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH); // write in skinny
 		app.shift.write();								   // write shifts wide*/
 		flushVOff = 0;
-		println("Flush valve turning on");
+		LOG_INFO(SAMPLE, "Flush valve turning on");
 		sampleVOff = 1;
 		//give valve 6 seconds to turn on
 		delay(6000);
@@ -81,7 +94,7 @@ void SampleStateFillTube::enter(KPStateMachine & sm) {
 	if (pumpOff){
 		app.pump.on();
 		pumpOff = 0;
-		println("Pump on");
+		LOG_INFO(SAMPLE, "Pump on");
 	}
 
 	setTimeCondition(time, [&]() { sm.next();});
@@ -95,7 +108,7 @@ void SampleStatePressureTare::enter(KPStateMachine & sm) {
 		app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH);  // write in skinny
 		app.shift.write();								   // write shifts wide*/
 		flushVOff = 0;
-		println("Flush valve turning on");
+		LOG_INFO(SAMPLE, "Flush valve turning on");
 		sampleVOff = 1;		
 		//give valve 6 seconds to turn on
 		delay(6000);
@@ -103,7 +116,7 @@ void SampleStatePressureTare::enter(KPStateMachine & sm) {
 	if (pumpOff){
 		app.pump.on();
 		pumpOff = 0;
-		println("Pump on");
+		LOG_INFO(SAMPLE, "Pump on");
 	}
 
 	sum	  = 0;
@@ -123,30 +136,18 @@ void SampleStatePressureTare::update(KPStateMachine & sm) {
 void SampleStatePressureTare::leave(KPStateMachine & sm) {
 	Application & app = *static_cast<Application *>(sm.controller);
 #ifndef DISABLE_PRESSURE_TARE
-	// get time for SD printing
-	const auto timenow = now();
-	std::stringstream ss;
-	ss << timenow;
-	std::string time_string = ss.str();
 	// Average pressure
 	int avg = sum / count;
-	//Prepare values for printing
-	char press_string[50];
-	sprintf(press_string, "%d.%02u", (int)avg, (int)((avg - (int)avg) * 100));
-	// Composite strings and print to SD
-	std::string strings[3] = {time_string,",Pressure,,, ", press_string};
-	csvw.writeStrings(strings, 3);
+	// Print to SD
+	csvw.writeLine(app.clock.timestamp(), ",Pressure,,, ", (float) avg);
 	// Print pressure to serial monitor
-	print("Normal pressure set to value: ");
-	println(avg);
+	LOG_INFO(SAMPLE, "Normal pressure set to value: ", avg);
 
 	// Set min and max pressure valves for pressure stopping criteria
 	app.pressure_sensor.max_pressure = avg + range_size;
 	app.pressure_sensor.min_pressure = avg - range_size;
-	print("Max pressure: ");
-	println(app.pressure_sensor.max_pressure);
-	print("Min pressure: ");
-	println(app.pressure_sensor.min_pressure);
+	LOG_INFO(SAMPLE, "Max pressure: ", app.pressure_sensor.max_pressure);
+	LOG_INFO(SAMPLE, "Min pressure: ", app.pressure_sensor.min_pressure);
 #endif
 #ifdef DISABLE_PRESSURE_TARE
 	SSD.println("Pressure tare state is disabled.");
@@ -165,20 +166,9 @@ void SampleStateOnramp::enter(KPStateMachine & sm) {
 	Application & app = *static_cast<Application *>(sm.controller);
 	// Get time and cycle and print to serial monitor and SD
 	//cycle to serial
-	print("Starting cycle number;");
-	println(app.sm.current_cycle);
-	//cycle prep for SD
-	char cycle_string[50];
-	sprintf(cycle_string, "%u", (int)app.sm.current_cycle);
-	// get time
-	const auto timenow = now();
-	std::stringstream ss;
-	ss << timenow;
-	std::string time_string = ss.str();
-	// put together string for SD
-	std::string strings[3] = {time_string,",Starting cycle ", cycle_string};
+	LOG_INFO(SAMPLE, "Starting cycle number;", app.sm.current_cycle);
 	//write to SD
-	csvw.writeStrings(strings, 3);
+	csvw.writeLine(app.clock.timestamp(), ",Starting cycle ", app.sm.current_cycle);
 
 	// turn on flush valve if off
 	if (flushVOff){
@@ -186,7 +176,7 @@ void SampleStateOnramp::enter(KPStateMachine & sm) {
 		app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH);  // write in skinny
 		app.shift.write();								   // write shifts wide*/
 		flushVOff = 0;
-		println("Flush valve turning on");
+		LOG_INFO(SAMPLE, "Flush valve turning on");
 		sampleVOff = 1;
 	}
 
@@ -203,7 +193,7 @@ void SampleStateFlush::enter(KPStateMachine & sm) {
 		app.shift.setPin(TPICDevices::FLUSH_VALVE, HIGH); // write in skinny
 		app.shift.write();								   // write shifts wide*/
 		flushVOff = 0;
-		println("Flush valve turning on");
+		LOG_INFO(SAMPLE, "Flush valve turning on");
 		sampleVOff = 1;
 		//give valve 6 seconds to turn on
 		delay(6000);
@@ -212,7 +202,7 @@ void SampleStateFlush::enter(KPStateMachine & sm) {
 	if (pumpOff){
 		app.pump.on();
 		pumpOff = 0;
-		println("Pump on");
+		LOG_INFO(SAMPLE, "Pump on");
 	}
 
 	setTimeCondition(time, [&]() { sm.next();});
@@ -223,7 +213,7 @@ void SampleStateBetweenPump::enter(KPStateMachine & sm) {
 	Application & app = *static_cast<Application *>(sm.controller);
 	app.pump.off();
 	pumpOff = 1;
-	println("Pump off");
+	LOG_INFO(SAMPLE, "Pump off");
 	setTimeCondition(time, [&]() { sm.next();});
 }
 
@@ -233,27 +223,21 @@ void SampleStateLoadBuffer::enter(KPStateMachine & sm) {
 	// Measure initial water temperature
 	tempC = app.pressure_sensor.getTemp();
 	//print to serial monitor
-	print("Temp: ");
-	println(tempC);
+	LOG_INFO(SAMPLE, "Temp: ", tempC);
 	// Get cycle and time to include with temperature print to SD
-	char cycle_string[50];
-	sprintf(cycle_string, "%u", (int)app.sm.current_cycle);
-	char tempC_string[50];
-	sprintf(tempC_string, "%d.%02u", (int)tempC, (int)((tempC - (int)tempC) * 100));
-	const auto timenow = now();
-	std::stringstream ss;
-	ss << timenow;
-	std::string time_string = ss.str();
-	std::string strings[5] = {time_string,",Starting temperature for cycle ", cycle_string,",,", tempC_string};
-	csvw.writeStrings(strings, 5);
-
-	// Take 25 measurements with load cell for initial mass value
-	current_tare = app.load_cell.reTare(25);
-	print("Tare load;");
-	println(current_tare);
-
-	// Move on to next state
-	sm.next();
+	csvw.writeLine(app.clock.timestamp(), ",Starting temperature for cycle ", app.sm.current_cycle, ",,", tempC);
+
+	// Filtered load for initial mass value. The tare runs in the background in case the filter
+	// is still settling, so the rest of the application stays responsive.
+	app.load_cell.beginReTare();
+	setCondition([&]() { return !app.load_cell.isReading(); },
+		[&]() {
+			current_tare = app.load_cell.tare;
+			LOG_INFO(SAMPLE, "Tare load;", current_tare);
+
+			// Move on to next state
+			sm.next();
+		});
 }
 
 // Between valve: Flush valve turned off, sample valve turned on, wait preset time for valve to fully open
@@ -265,7 +249,7 @@ void SampleStateBetweenValve::enter(KPStateMachine & sm) {
 		app.shift.setPin(TPICDevices::WATER_VALVE, HIGH);
 		app.shift.write();
 		sampleVOff = 0;
-		println("Sample valve turning on");
+		LOG_INFO(SAMPLE, "Sample valve turning on");
 		flushVOff = 1;
 	}
 	setTimeCondition(time, [&]() { sm.next();});
@@ -275,6 +259,7 @@ void SampleStateBetweenValve::enter(KPStateMachine & sm) {
 void SampleStateSample::enter(KPStateMachine & sm) {
 	Application & app = *static_cast<Application *>(sm.controller);
 	wt_offset = 0;
+	wt_offset_taken = 0;
 	current_tare = app.sm.getState<SampleStateLoadBuffer>(SampleStateNames::LOAD_BUFFER).current_tare;
 
 	//open sample valve if not open
@@ -283,150 +268,139 @@ void SampleStateSample::enter(KPStateMachine & sm) {
 		app.shift.setPin(TPICDevices::WATER_VALVE, HIGH);
 		app.shift.write();
 		sampleVOff = 0;
-		println("Sample valve turning on");
+		LOG_INFO(SAMPLE, "Sample valve turning on");
 		flushVOff = 1;
 		//give valve 6 seconds to turn on
 		delay(6000);
 	}
 
+	// Track the mass target at 80 SPS for a finer stop decision, once the board routes SPEED
+	app.load_cell.setSpeed(ADS1232::SPEED_80SPS);
+
 	//time and cycle to SD
-	const auto timenow = now();
-	std::stringstream ss;
-	ss << timenow;
-	std::string time_string = ss.str();
-	char cycle_string[50];
-	sprintf(cycle_string, "%u", (int)app.sm.current_cycle);
-	std::string strings[3] = {time_string, "Sample Start Cycle: ", cycle_string};
-	csvw.writeStrings(strings, 3);
+	csvw.writeLine(app.clock.timestamp(), ",Sample Start Cycle: ", app.sm.current_cycle);
 
 	// relative time for serial monitor and timing
-	sample_start_time = millis();
-	print("sample_start_time ms ;;;");
-	println(sample_start_time);
+	sample_start_time = app.clock.uptime();
+	last_load_log	  = 0;
 
 	// turn on pump if not on
 	if (pumpOff){
 		app.pump.on();
 		pumpOff = 0;
-		println("Pump on");
+		LOG_INFO(SAMPLE, "Pump on");
 	}
 
 	//check for stopping criteria
 	auto const condition = [&]() {
-		bool load = 0;
-		// get instantaneous load
-		new_load = app.load_cell.getLoad(1);
-		new_time = millis();
-		print("New mass reading;");
-		println(new_load);
-		print("New time;;;");
-		println(new_time);
-		// compensate for poor measurements for first 4
-		if (sampler==2){
-			if(load_count==4){
-				wt_offset = ((new_load - prior_load)/(new_time - prior_time))*(new_time - sample_start_time);
-				print("Weight offset;;;;");
-				println(wt_offset);
+		// the load criteria and the rate need a new conversion; time and pressure do not
+		bool conversion = app.load_cell.conversions != last_conversion;
+		last_conversion = app.load_cell.conversions;
+		new_time = app.clock.uptime();
+		if (conversion){
+			// get filtered load for the rate, and the despiked load for the stop tests: the moving
+			// average trails the scale by about 1.4 s, which would overshoot the target
+			new_load = app.load_cell.getLoad();
+			float stop_load = app.load_cell.getFastLoad();
+			if (new_time - last_load_log >= SampleSettings::LOAD_LOG_INTERVAL) {
+				csvw.writeLine(app.clock.timestamp(), ",Load, ", new_load);
+				last_load_log = new_time;
+			}
+			// compensate for poor measurements at the start, once the filtered load has caught up
+			if (sampler==2){
+				if (!wt_offset_taken
+					&& new_time - sample_start_time
+						   >= SampleSettings::OFFSET_DELAY + app.load_cell.filterLag()){
+					wt_offset = ((new_load - prior_load)/(new_time - prior_time))*(new_time - sample_start_time);
+					wt_offset_taken = 1;
+					LOG_DEBUG(SAMPLE, "Weight offset;;;;", wt_offset);
+				}
+			}
+			// use basic offset for sampler 1
+			else{
+				wt_offset = 0.05*mass;
+			}
+
+			// check for meeting load target
+			bool load = stop_load - current_tare >= mass - wt_offset;
+			if (load){
+				csvw.writeLine(app.clock.timestamp(), ",Ended due to load cycle: ", app.sm.current_cycle);
+				LOG_INFO(SAMPLE, "Sample state ended due to: load");
+				pressureEnded = 0;
+				return load;
 			}
-		}
-		// use basic offset for sampler 1
-		else{
-			wt_offset = 0.05*mass;
-		}
-		
-		//get time and cycle values for SD output
-		const auto timenow = now();
-		std::stringstream ss;
-		ss << timenow;
-		std::string time_string = ss.str();
-		char cycle_string[50];
-		sprintf(cycle_string, "%u", (int)app.sm.current_cycle);
-
-		// check for meeting load target
-		load = new_load - current_tare >= mass - wt_offset;
-		if (load){
-			std::string temp[3] = {time_string,",Ended due to load cycle: ",cycle_string};
-			csvw.writeStrings(temp, 3);
-			println("Sample state ended due to: load ");
-			pressureEnded = 0;
-			return load;
-		}
 
-			//if not exiting due to sample load, check overall load, time, and pressure
-		else{
 			// check load reading relative to cap of 2900 g
-			bool total_load = 0;
-			total_load = new_load > 2900;
+			bool total_load = stop_load > 2900;
 			if (total_load){
-				std::string temp[4] = {time_string,",Ended due to total load cycle: ",cycle_string};
-				csvw.writeStrings(temp, 4);
-				println("Sample state ended due to: total load ");
+				csvw.writeLine(app.clock.timestamp(), ",Ended due to total load cycle: ", app.sm.current_cycle);
+				LOG_INFO(SAMPLE, "Sample state ended due to: total load");
 				pressureEnded = 0;
 				// trigger end of all sampling
 				app.sm.current_cycle = app.sm.last_cycle;
 				return total_load;
 			}
-			
-			// check for time stopping criteria: t_max = SAMPLE_TIME; t_adj is iteratively calculated
-			bool t_max = timeSinceLastTransition() >= secsToMillis(time);
-			bool t_adj = timeSinceLastTransition() >= time_adj_ms;
-			if (t_max || t_adj){
-				std::string temp[4] = {time_string,",Ended due to time cycle: ",cycle_string};
-				csvw.writeStrings(temp, 4);
-				println("Sample state ended due to: time");
-				pressureEnded = 0;
-				return t_max || t_adj;
-			}
-			//if not exiting due to load and time, check pressure
-			else{
-				bool pressure = !app.pressure_sensor.isWithinPressure();
-				if (pressure){
-					std::string temp[4] = {time_string, ",Ended due to pressure cycle: ",cycle_string};
-					csvw.writeStrings(temp, 4);
-					println("Sample state ended due to: pressure");
-					pressureEnded = 1;
-					return pressure;
-				}
-				//if continuing, check pumping rate
-				else{
-					if (load_count > 0){
-						accum_load = new_load - current_tare;
-						accum_time = new_time - sample_start_time;
-						avg_rate = 1000*(accum_load/accum_time);
-						print("Average rate in g/s;;;;");
-						println(avg_rate,4);
-						//check to see if sampling time is appropriate
-						print("Coded time remaining in millis;;;");
-						code_time_est = time_adj_ms - timeSinceLastTransition();
-						println(code_time_est);
-						// update time if more than 10% off and new load - tare > 1
-						if (load_count > 5){
-							if (new_load - current_tare > 1){
-								weight_remaining = mass - (new_load - current_tare);
-								print("Weight remaining (mass - (new_load - current_tare));");
-								println(weight_remaining);
-								// calculate new time based upon average rate
-								new_time_est = weight_remaining/((new_load - current_tare)/(new_time - sample_start_time));
-								print("Estimated time remaining in ms: weight_remaining/average rate;;;");
-								println(new_time_est);
-								if (abs((code_time_est - new_time_est)/code_time_est) > 0.1){
-									time_adj_ms = new_time_est + timeSinceLastTransition();
-									print("Code time outside 10 percent of estimated time. Updated sampling time in millis;;;");
-									println(time_adj_ms);
-								}
-							}
-						}
-					}
-					// update for comparison in next loop
-					prior_load = new_load;
-					prior_time = new_time;
-					prior_rate = new_rate;
-					prior_time_est = new_time_est;
-					load_count += 1;
-					return load || total_load || t_max || t_adj || pressure;
+		}
+
+		// check for time stopping criteria: t_max = SAMPLE_TIME; t_adj is iteratively calculated
+		bool t_max = timeSinceLastTransition() >= secsToMillis(time);
+		bool t_adj = timeSinceLastTransition() >= time_adj_ms;
+		if (t_max || t_adj){
+			csvw.writeLine(app.clock.timestamp(), ",Ended due to time cycle: ", app.sm.current_cycle);
+			LOG_INFO(SAMPLE, "Sample state ended due to: time");
+			pressureEnded = 0;
+			return t_max || t_adj;
+		}
+
+		//if not exiting due to load and time, check pressure
+		bool pressure = !app.pressure_sensor.isWithinPressure();
+		if (pressure){
+			csvw.writeLine(app.clock.timestamp(), ",Ended due to pressure cycle: ", app.sm.current_cycle);
+			LOG_INFO(SAMPLE, "Sample state ended due to: pressure");
+			pressureEnded = 1;
+			return pressure;
+		}
+
+		//if continuing, check pumping rate
+		if (!conversion){
+			return false;
+		}
+
+		accum_time = new_time - sample_start_time;
+		if (accum_time > 0){
+			accum_load = new_load - current_tare;
+			avg_rate = 1000*(accum_load/accum_time);
+			LOG_DEBUG(SAMPLE, "Average rate in g/s;;;;", avg_rate);
+			//check to see if sampling time is appropriate
+			code_time_est = time_adj_ms - timeSinceLastTransition();
+			LOG_DEBUG(SAMPLE, "Coded time remaining in millis;;;", code_time_est);
+			// update time if more than 10% off and new load - tare > 1
+			if (accum_time >= SampleSettings::RATE_DELAY + app.load_cell.filterLag()){
+				if (new_load - current_tare > 1){
+					weight_remaining = mass - (new_load - current_tare);
+					LOG_DEBUG(SAMPLE, "Weight remaining (mass - (new_load - current_tare));",
+						weight_remaining);
+					// calculate new time based upon average rate
+					new_time_est = weight_remaining/((new_load - current_tare)/(new_time - sample_start_time));
+					LOG_DEBUG(SAMPLE,
+						"Estimated time remaining in ms: weight_remaining/average rate;;;",
+						new_time_est);
+					if (abs((code_time_est - new_time_est)/code_time_est) > 0.1){
+						time_adj_ms = new_time_est + timeSinceLastTransition();
+						LOG_DEBUG(SAMPLE,
+							"Code time outside 10 percent of estimated time. Updated "
+							"sampling time in millis;;;",
+							time_adj_ms);
 					}
 				}
 			}
+		}
+		// update for comparison in next loop
+		prior_load = new_load;
+		prior_time = new_time;
+		prior_rate = new_rate;
+		prior_time_est = new_time_est;
+		return false;
 	};
 	setCondition(condition, [&]() { sm.next();});
 }
@@ -434,8 +408,8 @@ void SampleStateSample::enter(KPStateMachine & sm) {
 // Sample leave
 void SampleStateSample::leave(KPStateMachine & sm) {
 	Application & app = *static_cast<Application *>(sm.controller);
-	load_count = 0;
 	prior_load = 0;
+	app.load_cell.setSpeed(ADS1232::SPEED_10SPS);
 }
 
 // Stop: Sample valve and pump turned off. Wait preset time to reduce noise in final load measurement
@@ -444,12 +418,11 @@ void SampleStateStop::enter(KPStateMachine & sm) {
 	//turn off pump
 	app.pump.off();
 	pumpOff = 1;
-	println("Pump off");
+	LOG_INFO(SAMPLE, "Pump off");
 
-	// get and print relative end time
-	sample_end_time = millis();
-	print("Sample_end_time ms;;;");
-	println(sample_end_time);
+	// relative end time for the pumping rate
+	sample_end_time = app.clock.uptime();
+	csvw.writeLine(app.clock.timestamp(), ",Sample end cycle: ", app.sm.current_cycle);
 
 	//turn off both valves
 	app.shift.writeAllRegistersLow();
@@ -459,16 +432,7 @@ void SampleStateStop::enter(KPStateMachine & sm) {
 
 	//get and print to SD pressure after pump and valves are off
 	long curr_pressure = app.pressure_sensor.getPressure();
-	char press_string[50];
-	sprintf(press_string, "%Lu", (long)curr_pressure);
-	const auto timenow = now();
-	std::stringstream ss;
-	ss << timenow;
-	std::string time_string = ss.str();
-	char cycle_string[50];
-	sprintf(cycle_string, "%u", (int)app.sm.current_cycle);
-	std::string strings[5] = {time_string,",Ending pressure for cycle: ",cycle_string,",,, ", press_string};
-	csvw.writeStrings(strings, 5);
+	csvw.writeLine(app.clock.timestamp(), ",Ending pressure for cycle: ", app.sm.current_cycle, ",,, ", curr_pressure);
 
 	setTimeCondition(time, [&]() { sm.next();});
 }
@@ -477,61 +441,52 @@ void SampleStateStop::enter(KPStateMachine & sm) {
 void SampleStateLogBuffer::enter(KPStateMachine & sm) {
 	Application & app = *static_cast<Application *>(sm.controller);
 
-	// Take 25 measurements and average for total load at end of cycle	
-	final_load = app.load_cell.getLoad(25);
+	// Filtered load for total load at end of cycle
+	app.load_cell.beginRead();
+	setCondition([&]() { return !app.load_cell.isReading(); }, [&]() { log(sm); });
+}
+
+// Log buffer: Evaluate the cycle once the final load is in
+void SampleStateLogBuffer::log(KPStateMachine & sm) {
+	Application & app = *static_cast<Application *>(sm.controller);
+	final_load = app.load_cell.readTask.load;
 	// Print to serial monitor
-	print("Load at end of cycle;");
-	print(app.sm.current_cycle);
-	print(";");
-	println(final_load,3);
+	LOG_INFO(SAMPLE, "Load at end of cycle;", app.sm.current_cycle, ";", final_load);
 
 	//evaluate load and sampling time
 	current_tare = app.sm.getState<SampleStateLoadBuffer>(SampleStateNames::LOAD_BUFFER).current_tare;
 	// Calculate cycle load
 	sampledLoad = final_load - current_tare;
-	print("sampledLoad: final_load - current_tare;");
-	println(sampledLoad);
+	LOG_INFO(SAMPLE, "sampledLoad: final_load - current_tare;", sampledLoad);
 	//Prepare and print to SD
-	char cycle_string[50];
-	sprintf(cycle_string, "%u", (int)app.sm.current_cycle);
-	char sampledload_string[50];
-	sprintf(sampledload_string, "%d.%02u", (int)sampledLoad, (int)((sampledLoad - (int)sampledLoad) * 100));
-	const auto timenow = now();
-	std::stringstream ss;
-	ss << timenow;
-	std::string time_string = ss.str();
-	std::string strings[5] = {time_string,",Sampled load at end of cycle ", cycle_string,",",sampledload_string};
-	csvw.writeStrings(strings, 5);
+	csvw.writeLine(app.clock.timestamp(), ",Sampled load at end of cycle ", app.sm.current_cycle, ",", sampledLoad);
 
 	// Calculate and print to serial cycle time
 	sampledTime = (sample_end_time - sample_start_time);
-	print("sampledTime period in ms;;");
-	println(sampledTime);
+	LOG_INFO(SAMPLE, "sampledTime period in ms;;", sampledTime);
 
 	//calculate and print to serial average pumping rate
 	average_pump_rate = (sampledLoad / sampledTime)*1000;
-	print("Average pumping rate grams/sec: 1000*sampledLoad/sampledTime;;;");
-	println(average_pump_rate,4);
+	LOG_INFO(SAMPLE, "Average pumping rate grams/sec: 1000*sampledLoad/sampledTime;;;",
+		average_pump_rate);
 
 	// calculate and print to serial cycle load relative to target
 	mass = app.sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).mass;
 	load_diff = mass - sampledLoad;
-	print("load_diff: mass - sampledLoad;;;");
-	println(load_diff);
+	LOG_INFO(SAMPLE, "load_diff: mass - sampledLoad;;;", load_diff);
 
 	//update time if sample didn't end due to pressure
 	//change time opposite sign of load diff (increase for negative, decrease for positive)
 	if (!pressureEnded){	
 		// change sampling time if load was +- 5% off from set weight
 		if (abs(mass - sampledLoad)/mass > 0.05){
-			println("Sample mass outside of 5 percent tolerance");
+			LOG_INFO(SAMPLE, "Sample mass outside of 5 percent tolerance");
 			sampledTime += (load_diff)/average_pump_rate;
-			print("new sampling time period in ms: load diff/avg rate;;");
+			LOG_INFO(SAMPLE, "new sampling time period in ms: load diff/avg rate;;", sampledTime);
 		}
 		else {
-			print("Sampling time period set to match last sample time;;");
+			LOG_INFO(SAMPLE, "Sampling time period set to match last sample time;;", sampledTime);
 		}
-		println(sampledTime);
 		//set new sample time
 		app.sm.getState<SampleStateSample>(SampleStateNames::SAMPLE).time_adj_ms = sampledTime;
 	}
@@ -2,6 +2,8 @@
 #include <KPState.hpp>
 #include <Application/Constants.hpp>
 
+class Clock;
+
 namespace SampleStateNames {
 	constexpr const char * IDLE				= "sample-state-idle";
 	constexpr const char * SETUP			= "sample-state-setup";
@@ -19,10 +21,15 @@ namespace SampleStateNames {
 	constexpr const char * FINISHED			= "sample-state-finished";
 };	// namespace SampleStateNames
 
+// Wait for the next cycle. The start is kept on the DS3232 (alarm 1) so the MCU can sleep through.
 class SampleStateIdle : public KPState {
 public:
 	void enter(KPStateMachine & sm) override;
+	void leave(KPStateMachine & sm) override;
+	unsigned long idleTime() const override;
 	int time = DefaultTimes::IDLE_TIME;
+	time_t cycle_start = 0;
+	const Clock * clock = nullptr;
 };
 
 // Time before first cycle starts: SETUP_TIME
@@ -54,6 +61,10 @@ public:
 	void enter(KPStateMachine & sm) override;
 	void update(KPStateMachine & sm) override;
 	void leave(KPStateMachine & sm) override;
+	// Pressure is sampled on every update
+	unsigned long idleTime() const override {
+		return 0;
+	}
 	int time = 5;
 	long sum;
 	int count;
@@ -114,8 +125,8 @@ public:
 	float prior_time_est;
 	float code_time_est;
 	float new_load = 0;
-	unsigned long prior_time;
-	unsigned long new_time;
+	uint64_t prior_time;
+	uint64_t new_time;
 	float prior_rate = 0;
 	float new_rate;
 	float wt_offset;
@@ -132,6 +143,7 @@ public:
 class SampleStateLogBuffer : public KPState {
 public:
 	void enter(KPStateMachine & sm) override;
+	void log(KPStateMachine & sm);
 	float final_load;
 	float current_tare;
 	float sampledLoad;
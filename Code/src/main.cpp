@@ -9,7 +9,7 @@ void setup() {
 
 	// Watchdog timer
 	#ifdef WATCHDOG
-		Watchdog.enable(12000);
+		Watchdog.enable(PowerSettings::WATCHDOG_TIMEOUT);
 	#endif
 }
 
@@ -20,4 +20,6 @@ void loop() {
 #ifdef WATCHDOG
 	Watchdog.reset();
 #endif
+
+	app.idle();
 }
\ No newline at end of file